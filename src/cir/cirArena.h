@@ -0,0 +1,177 @@
+/****************************************************************************
+  FileName     [ cirArena.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define slab storage and CSR index of fanout lists ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2012-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_ARENA_H
+#define CIR_ARENA_H
+
+#include <vector>
+#include <cassert>
+#include "cirDef.h"
+
+using namespace std;
+
+// Fanout lists of all gates carved out of one slab. Gate g owns the block
+// _slab[_begin[g] .. _begin[g] + _cap[g]) of which the first _size[g]
+// entries are used. A full block moves to a block twice as large; the
+// old one is kept on a free list by the power of two it can hold and
+// handed out again. Nothing is returned to the heap until init() drops
+// the whole slab, so loading and replacing a circuit costs a handful of
+// allocations regardless of its size.
+class FanoutArena
+{
+public:
+   FanoutArena() : _stamp(0) {}
+   ~FanoutArena() {}
+
+   // "n" gates with empty lists; "slab" entries are allocated up front
+   void init(size_t n, size_t slab = 0) {
+      ++_stamp;
+      vector<unsigned>().swap(_slab);
+      _slab.reserve(slab);
+      _begin.assign(n, 0);
+      _size.assign(n, 0);
+      _cap.assign(n, 0);
+      for (int c = 0; c < NUM_CLASS; ++c) _free[c].clear();
+   }
+
+   // Add gates with empty lists up to "n"
+   void resize(size_t n) {
+      ++_stamp;
+      _begin.resize(n, 0);
+      _size.resize(n, 0);
+      _cap.resize(n, 0);
+   }
+
+   // bumped by every change of any list
+   unsigned long stamp() const { return _stamp; }
+   size_t numGates() const { return _size.size(); }
+   unsigned size(unsigned g) const { return _size[g]; }
+   bool empty(unsigned g) const { return !_size[g]; }
+   unsigned operator () (unsigned g, unsigned i) const {
+      assert(i < _size[g]);
+      return _slab[_begin[g] + i];
+   }
+
+   // Make room for "n" entries; reserving the exact count before the
+   // first push lays the lists out back to back in gate order
+   void reserve(unsigned g, unsigned n) {
+      ++_stamp;
+      if (n > _cap[g]) move(g, n);
+   }
+   void push(unsigned g, unsigned fo) {
+      ++_stamp;
+      if (_size[g] == _cap[g]) move(g, _cap[g] ? _cap[g] * 2 : 2);
+      _slab[_begin[g] + _size[g]++] = fo;
+   }
+   // Remove the i-th entry, keeping the others in order
+   void erase(unsigned g, unsigned i) {
+      assert(i < _size[g]);
+      ++_stamp;
+      unsigned *p = &_slab[_begin[g]];
+      for (unsigned j = i + 1; j < _size[g]; ++j) p[j - 1] = p[j];
+      --_size[g];
+   }
+   // Remove the entries "dead" is set for from every list, keeping the
+   // others in order
+   void eraseIf(const vector<bool>& dead) {
+      ++_stamp;
+      for (size_t g = 0, n = _size.size(); g < n; ++g) {
+         if (!_size[g]) continue;
+         unsigned *p = &_slab[_begin[g]], k = 0;
+         for (unsigned j = 0; j < _size[g]; ++j)
+            if (!dead[p[j]]) p[k++] = p[j];
+         _size[g] = k;
+      }
+   }
+   // Empty the list and give its block back
+   void release(unsigned g) {
+      ++_stamp;
+      if (_cap[g]) _free[sizeClass(_cap[g])].push_back(_begin[g]);
+      _begin[g] = _size[g] = _cap[g] = 0;
+   }
+
+private:
+   enum { NUM_CLASS = 32 };
+   vector<unsigned>  _slab;
+   IdList            _begin;
+   IdList            _size;
+   IdList            _cap;
+   IdList            _free[NUM_CLASS]; // free blocks holding >= 2^c entries
+   unsigned long     _stamp;
+
+   // largest c with 2^c <= n
+   static int sizeClass(unsigned n) {
+      int c = 0;
+      while (n >>= 1) ++c;
+      return c;
+   }
+   void move(unsigned g, unsigned n) {
+      unsigned b, cap;
+      int c = sizeClass(n);
+      if (n & (n - 1)) ++c;          // round up to 2^c
+      if (c < NUM_CLASS && !_free[c].empty()) {
+         b = _free[c].back();
+         _free[c].pop_back();
+         cap = 1u << c;
+      }
+      else {
+         b = _slab.size();
+         cap = n;
+         _slab.resize(b + cap);
+      }
+      for (unsigned j = 0; j < _size[g]; ++j)
+         _slab[b + j] = _slab[_begin[g] + j];
+      unsigned size = _size[g];
+      release(g);
+      _begin[g] = b;
+      _size[g] = size;
+      _cap[g] = cap;
+   }
+};
+
+// Read-only snapshot of a FanoutArena in compressed sparse row form: the
+// fanouts of g are _target[_begin[g] .. _begin[g + 1]), in the order of
+// the arena. It is rebuilt in one pass when the arena has changed since.
+class FanoutIndex
+{
+public:
+   FanoutIndex() : _stamp(0), _valid(false) {}
+   ~FanoutIndex() {}
+
+   bool upToDate(const FanoutArena& fos) const {
+      return _valid && _stamp == fos.stamp();
+   }
+   void build(const FanoutArena& fos) {
+      size_t n = fos.numGates();
+      _begin.resize(n + 1);
+      _begin[0] = 0;
+      for (size_t g = 0; g < n; ++g)
+         _begin[g + 1] = _begin[g] + fos.size(g);
+      _target.resize(_begin[n]);
+      for (size_t g = 0; g < n; ++g)
+         for (unsigned i = 0, m = fos.size(g); i < m; ++i)
+            _target[_begin[g] + i] = fos(g, i);
+      _stamp = fos.stamp();
+      _valid = true;
+   }
+
+   unsigned size(unsigned g) const { return _begin[g + 1] - _begin[g]; }
+   bool empty(unsigned g) const { return _begin[g + 1] == _begin[g]; }
+   unsigned operator () (unsigned g, unsigned i) const {
+      assert(i < size(g));
+      return _target[_begin[g] + i];
+   }
+
+private:
+   IdList            _begin;
+   IdList            _target;
+   unsigned long     _stamp;
+   bool              _valid;
+};
+
+#endif // CIR_ARENA_H
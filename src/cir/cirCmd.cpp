@@ -28,8 +28,12 @@ initCirCmd()
          cmdMgr->regCmd("CIRSWeep", 5, new CirSweepCmd) &&
          cmdMgr->regCmd("CIROPTimize", 6, new CirOptCmd) &&
          cmdMgr->regCmd("CIRSTRash", 6, new CirStrashCmd) &&
+         cmdMgr->regCmd("CIRCompact", 4, new CirCompactCmd) &&
+         cmdMgr->regCmd("CIRREWrite", 6, new CirRewriteCmd) &&
+         cmdMgr->regCmd("CIRBalance", 4, new CirBalanceCmd) &&
          cmdMgr->regCmd("CIRSIMulate", 6, new CirSimCmd) &&
          cmdMgr->regCmd("CIRFraig", 4, new CirFraigCmd) &&
+         cmdMgr->regCmd("CIRRESub", 6, new CirResubCmd) &&
          cmdMgr->regCmd("CIRWrite", 4, new CirWriteCmd)
       )) {
       cerr << "Registering \"cir\" commands fails... exiting" << endl;
@@ -54,7 +58,7 @@ enum CirCmdState
 static CirCmdState curCmd = CIRINIT;
 
 //----------------------------------------------------------------------
-//    CIRRead <(string fileName)> [-Replace]
+//    CIRRead <(string fileName)> [-Replace] [-Strash]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirReadCmd::exec(const string& option)
@@ -66,13 +70,17 @@ CirReadCmd::exec(const string& option)
    if (options.empty())
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
 
-   bool doReplace = false;
+   bool doReplace = false, doStrash = false;
    string fileName;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Replace", options[i], 2) == 0) {
          if (doReplace) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
          doReplace = true;
       }
+      else if (myStrNCmp("-Strash", options[i], 2) == 0) {
+         if (doStrash) return CmdExec::errorOption(CMD_OPT_EXTRA,options[i]);
+         doStrash = true;
+      }
       else {
          if (fileName.size())
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -93,13 +101,13 @@ CirReadCmd::exec(const string& option)
    }
    cirMgr = new CirMgr;
 
-   if (!cirMgr->readCircuit(fileName)) {
+   if (!cirMgr->readCircuit(fileName, doStrash)) {
       curCmd = CIRINIT;
       delete cirMgr; cirMgr = 0;
       return CMD_EXEC_ERROR;
    }
 
-   curCmd = CIRREAD;
+   curCmd = (doStrash ? CIRSTRASH : CIRREAD);
 
    return CMD_EXEC_DONE;
 }
@@ -107,7 +115,7 @@ CirReadCmd::exec(const string& option)
 void
 CirReadCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRRead <(string fileName)> [-Replace]" << endl;
+   os << "Usage: CIRRead <(string fileName)> [-Replace] [-Strash]" << endl;
 }
 
 void
@@ -184,7 +192,7 @@ CirGateCmd::exec(const string& option)
 
    int gateId = -1, level = 0;
    bool doFanin = false, doFanout = false;
-   CirGate* thisGate = 0;
+   bool hasGate = false;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       bool checkLevel = false;
       if (myStrNCmp("-FANIn", options[i], 5) == 0) {
@@ -199,16 +207,16 @@ CirGateCmd::exec(const string& option)
          doFanout = true;
          checkLevel = true;
       }
-      else if (!thisGate) {
+      else if (!hasGate) {
          if (!myStr2Int(options[i], gateId) || gateId < 0)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
-         thisGate = cirMgr->getGate(gateId);
-         if (!thisGate) {
+         hasGate = cirMgr->hasGate(gateId);
+         if (!hasGate) {
             cerr << "Error: Gate(" << gateId << ") not found!!" << endl;
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[0]);
          }
       }
-      else if (thisGate)
+      else if (hasGate)
          return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
       else
          return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -221,17 +229,17 @@ CirGateCmd::exec(const string& option)
       }
    }
 
-   if (!thisGate) {
+   if (!hasGate) {
       cerr << "Error: Gate id is not specified!!" << endl;
       return CmdExec::errorOption(CMD_OPT_MISSING, options.back());
    }
 
    if (doFanin)
-      thisGate->reportFanin(level);
+      cirMgr->reportFanin(gateId, level);
    else if (doFanout)
-      thisGate->reportFanout(level);
+      cirMgr->reportFanout(gateId, level);
    else
-      thisGate->reportGate();
+      cirMgr->reportGate(gateId);
 
    return CMD_EXEC_DONE;
 }
@@ -263,11 +271,17 @@ CirSweepCmd::exec(const string& option)
    vector<string> options;
    CmdExec::lexOptions(option, options);
 
-   if (!options.empty())
-      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+   bool verbose = true;
+   if (!options.empty()) {
+      if (myStrNCmp("-Quiet", options[0], 2) != 0)
+         return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[0]);
+      if (options.size() > 1)
+         return CmdExec::errorOption(CMD_OPT_EXTRA, options[1]);
+      verbose = false;
+   }
 
    assert(curCmd != CIRINIT);
-   cirMgr->sweep();
+   cirMgr->sweep(verbose);
 
    return CMD_EXEC_DONE;
 }
@@ -275,7 +289,7 @@ CirSweepCmd::exec(const string& option)
 void
 CirSweepCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRSWeep" << endl;
+   os << "Usage: CIRSWeep [-Quiet]" << endl;
 }
 
 void
@@ -374,7 +388,134 @@ CirStrashCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRSIMulate <-Random | -File <string patternFile>>
+//    CIRCompact
+//----------------------------------------------------------------------
+CmdExecStatus
+CirCompactCmd::exec(const string& option)
+{
+   if (!cirMgr) {
+      cerr << "Error: circuit is not yet constructed!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   // check option
+   vector<string> options;
+   CmdExec::lexOptions(option, options);
+
+   if (!options.empty())
+      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+
+   assert(curCmd != CIRINIT);
+   if (curCmd == CIRSIMULATE) {
+      cerr << "Error: circuit has been simulated!! Do \"CIRFraig\" first!!"
+           << endl;
+      return CMD_EXEC_ERROR;
+   }
+   cirMgr->compact();
+   curCmd = CIROPT;
+
+   return CMD_EXEC_DONE;
+}
+
+void
+CirCompactCmd::usage(ostream& os) const
+{
+   os << "Usage: CIRCompact" << endl;
+}
+
+void
+CirCompactCmd::help() const
+{
+   cout << setw(15) << left << "CIRCompact: "
+        << "renumber the gates densely\n";
+}
+
+//----------------------------------------------------------------------
+//    CIRREWrite
+//----------------------------------------------------------------------
+CmdExecStatus
+CirRewriteCmd::exec(const string& option)
+{
+   if (!cirMgr) {
+      cerr << "Error: circuit is not yet constructed!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   // check option
+   vector<string> options;
+   CmdExec::lexOptions(option, options);
+
+   if (!options.empty())
+      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+
+   assert(curCmd != CIRINIT);
+   if (curCmd == CIRSIMULATE) {
+      cerr << "Error: circuit has been simulated!! Do \"CIRFraig\" first!!"
+           << endl;
+      return CMD_EXEC_ERROR;
+   }
+   cirMgr->rewrite();
+   curCmd = CIROPT;
+
+   return CMD_EXEC_DONE;
+}
+
+void
+CirRewriteCmd::usage(ostream& os) const
+{
+   os << "Usage: CIRREWrite" << endl;
+}
+
+void
+CirRewriteCmd::help() const
+{
+   cout << setw(15) << left << "CIRREWrite: "
+        << "rewrite 4-input cuts with smaller NPN library graphs\n";
+}
+
+//----------------------------------------------------------------------
+//    CIRBalance
+//----------------------------------------------------------------------
+CmdExecStatus
+CirBalanceCmd::exec(const string& option)
+{
+   if (!cirMgr) {
+      cerr << "Error: circuit is not yet constructed!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   // check option
+   vector<string> options;
+   CmdExec::lexOptions(option, options);
+
+   if (!options.empty())
+      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+
+   assert(curCmd != CIRINIT);
+   if (curCmd == CIRSIMULATE) {
+      cerr << "Error: circuit has been simulated!! Do \"CIRFraig\" first!!"
+           << endl;
+      return CMD_EXEC_ERROR;
+   }
+   cirMgr->balance();
+   curCmd = CIROPT;
+
+   return CMD_EXEC_DONE;
+}
+
+void
+CirBalanceCmd::usage(ostream& os) const
+{
+   os << "Usage: CIRBalance" << endl;
+}
+
+void
+CirBalanceCmd::help() const
+{
+   cout << setw(15) << left << "CIRBalance: "
+        << "rebuild AND supergates with minimum depth\n";
+}
+
+//----------------------------------------------------------------------
+//    CIRSIMulate <-Random [-Seed (int seed)] [-Threads (int num)] |
+//                 -File <string patternFile>>
 //                [-Output (string logFile)]
 //----------------------------------------------------------------------
 CmdExecStatus
@@ -390,13 +531,33 @@ CirSimCmd::exec(const string& option)
 
    ifstream patternFile;
    ofstream logFile;
-   bool doRandom = false, doFile = false, doLog = false;
+   bool doRandom = false, doFile = false, doLog = false, doSeed = false;
+   bool doThread = false;
+   int seed = 0, nThread = 1;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Random", options[i], 2) == 0) {
          if (doRandom || doFile)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          doRandom = true;
       }
+      else if (myStrNCmp("-Seed", options[i], 2) == 0) {
+         if (doSeed)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], seed) || seed < 0)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doSeed = true;
+      }
+      else if (myStrNCmp("-Threads", options[i], 2) == 0) {
+         if (doThread)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         if (++i == n)
+            return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
+         if (!myStr2Int(options[i], nThread) || nThread < 1)
+            return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
+         doThread = true;
+      }
       else if (myStrNCmp("-File", options[i], 2) == 0) {
          if (doRandom || doFile)
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
@@ -423,14 +584,20 @@ CirSimCmd::exec(const string& option)
 
    if (!doRandom && !doFile)
       return CmdExec::errorOption(CMD_OPT_MISSING, "");
+   if (doSeed && !doRandom)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Seed");
+   if (doThread && !doRandom)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Threads");
 
    assert (curCmd != CIRINIT);
    if (doLog)
       cirMgr->setSimLog(&logFile);
    else cirMgr->setSimLog(0);
 
+   if (doSeed)
+      cirMgr->setSimSeed(seed);
    if (doRandom)
-      cirMgr->randomSim();
+      cirMgr->randomSim(nThread);
    else
       cirMgr->fileSim(patternFile);
    cirMgr->setSimLog(0);
@@ -442,7 +609,8 @@ CirSimCmd::exec(const string& option)
 void
 CirSimCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRSIMulate <-Random | -File <string patternFile>>\n"
+   os << "Usage: CIRSIMulate <-Random [-Seed (int seed)] [-Threads (int num)] |\n"
+      << "                    -File <string patternFile>>\n"
       << "                   [-Output (string logFile)]" << endl;
 }
 
@@ -494,7 +662,49 @@ CirFraigCmd::help() const
 }
 
 //----------------------------------------------------------------------
-//    CIRWrite [(int gateId)][-Output (string aagFile)]
+//    CIRRESub
+//----------------------------------------------------------------------
+CmdExecStatus
+CirResubCmd::exec(const string& option)
+{
+   if (!cirMgr) {
+      cerr << "Error: circuit is not yet constructed!!" << endl;
+      return CMD_EXEC_ERROR;
+   }
+   // check option
+   vector<string> options;
+   CmdExec::lexOptions(option, options);
+
+   if (!options.empty())
+      return CmdExec::errorOption(CMD_OPT_EXTRA, options[0]);
+
+   assert(curCmd != CIRINIT);
+   if (curCmd == CIRSIMULATE) {
+      cerr << "Error: circuit has been simulated!! Do \"CIRFraig\" first!!"
+           << endl;
+      return CMD_EXEC_ERROR;
+   }
+   cirMgr->resub();
+   curCmd = CIROPT;
+
+   return CMD_EXEC_DONE;
+}
+
+void
+CirResubCmd::usage(ostream& os) const
+{
+   os << "Usage: CIRRESub" << endl;
+}
+
+void
+CirResubCmd::help() const
+{
+   cout << setw(15) << left << "CIRRESub: "
+        << "resubstitute gates by simulation and SAT\n";
+}
+
+//----------------------------------------------------------------------
+//    CIRWrite [(int gateId)][-Output (string aagFile)][-Binary]
 //----------------------------------------------------------------------
 CmdExecStatus
 CirWriteCmd::exec(const string& option)
@@ -511,9 +721,8 @@ CirWriteCmd::exec(const string& option)
       cirMgr->writeAag(cout);
       return CMD_EXEC_DONE;
    }
-   bool hasFile = false;
-   int gateId;
-   CirGate *thisGate = NULL;
+   bool hasFile = false, binary = false;
+   int gateId, thisGate = -1;
    ofstream outfile;
    for (size_t i = 0, n = options.size(); i < n; ++i) {
       if (myStrNCmp("-Output", options[i], 2) == 0) {
@@ -521,31 +730,39 @@ CirWriteCmd::exec(const string& option)
             return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
          if (++i == n)
             return CmdExec::errorOption(CMD_OPT_MISSING, options[i-1]);
-         outfile.open(options[i].c_str(), ios::out);
+         outfile.open(options[i].c_str(), ios::out | ios::binary);
          if (!outfile)
             return CmdExec::errorOption(CMD_OPT_FOPEN_FAIL, options[1]);
          hasFile = true;
       }
+      else if (myStrNCmp("-Binary", options[i], 2) == 0) {
+         if (binary)
+            return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
+         binary = true;
+      }
       else if (myStr2Int(options[i], gateId) && gateId >= 0) {
-         if (thisGate != NULL)
+         if (thisGate >= 0)
             return CmdExec::errorOption(CMD_OPT_EXTRA, options[i]);
-         thisGate = cirMgr->getGate(gateId);
-         if (!thisGate) {
+         if (!cirMgr->hasGate(gateId)) {
             cerr << "Error: Gate(" << gateId << ") not found!!" << endl;
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          }
-         if (!thisGate->isAig()) {
+         if (!cirMgr->isAig(gateId)) {
              cerr << "Error: Gate(" << gateId << ") is NOT an AIG!!" << endl;
             return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
          }
+         thisGate = gateId;
       }
       else return CmdExec::errorOption(CMD_OPT_ILLEGAL, options[i]);
    }
 
-   if (!thisGate) {
-      assert (hasFile);
-      cirMgr->writeAag(outfile);
+   if (thisGate < 0) {
+      ostream &os = hasFile ? (ostream&)outfile : cout;
+      if (binary) cirMgr->writeAig(os);
+      else cirMgr->writeAag(os);
    }
+   else if (binary)
+      return CmdExec::errorOption(CMD_OPT_ILLEGAL, "-Binary");
    else if (hasFile) cirMgr->writeGate(outfile, thisGate);
    else cirMgr->writeGate(cout, thisGate);
 
@@ -555,13 +772,14 @@ CirWriteCmd::exec(const string& option)
 void
 CirWriteCmd::usage(ostream& os) const
 {
-   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)]" << endl;
+   os << "Usage: CIRWrite [(int gateId)][-Output (string aagFile)][-Binary]"
+      << endl;
 }
 
 void
 CirWriteCmd::help() const
 {
    cout << setw(15) << left << "CIRWrite: "
-        << "write the netlist to an ASCII AIG file (.aag)\n";
+        << "write the netlist to an AIG file (.aag, or .aig with -Binary)\n";
 }
 
@@ -17,8 +17,12 @@ CmdClass(CirGateCmd);
 CmdClass(CirSweepCmd);
 CmdClass(CirOptCmd);
 CmdClass(CirStrashCmd);
+CmdClass(CirCompactCmd);
+CmdClass(CirRewriteCmd);
+CmdClass(CirBalanceCmd);
 CmdClass(CirSimCmd);
 CmdClass(CirFraigCmd);
+CmdClass(CirResubCmd);
 CmdClass(CirWriteCmd);
 
 #endif // CIR_CMD_H
@@ -0,0 +1,275 @@
+/****************************************************************************
+  FileName     [ cirCut.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define cut enumeration of cir package ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2012-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cassert>
+#include "cirMgr.h"
+#include "cirGate.h"
+#include "cirCut.h"
+
+using namespace std;
+
+/*******************************/
+/*   Global variable and enum  */
+/*******************************/
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+static const TruthTab elemTT[CUT_MAX_LEAVES] = {
+   0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+   0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL
+};
+
+// bits that stay, move up and move down when variables v and v + 1 swap
+static const TruthTab swapMask[CUT_MAX_LEAVES - 1][3] = {
+   { 0x9999999999999999ULL, 0x2222222222222222ULL, 0x4444444444444444ULL },
+   { 0xC3C3C3C3C3C3C3C3ULL, 0x0C0C0C0C0C0C0C0CULL, 0x3030303030303030ULL },
+   { 0xF00FF00FF00FF00FULL, 0x00F000F000F000F0ULL, 0x0F000F000F000F00ULL },
+   { 0xFF0000FFFF0000FFULL, 0x0000FF000000FF00ULL, 0x00FF000000FF0000ULL },
+   { 0xFFFF00000000FFFFULL, 0x00000000FFFF0000ULL, 0x0000FFFF00000000ULL }
+};
+
+static inline TruthTab
+swapAdjacent(TruthTab t, unsigned v)
+{
+   unsigned s = 1u << v;
+   return (t & swapMask[v][0]) | ((t & swapMask[v][1]) << s) |
+          ((t & swapMask[v][2]) >> s);
+}
+
+static inline bool
+dependsOn(TruthTab t, unsigned v)
+{
+   return ((t >> (1u << v)) & ~elemTT[v]) != (t & ~elemTT[v]);
+}
+
+// Move the variables of "t" from the leaves of "c" to those of "u", a
+// superset of them. The variables above c._size are unused, so each
+// leaf, last first, can be swapped up to its place.
+static TruthTab
+stretch(TruthTab t, const Cut &c, const Cut &u)
+{
+   int j = u._size - 1;
+   for(int i = c._size - 1; i >= 0; --i){
+      while(u._leaves[j] != c._leaves[i])
+         --j;
+      for(int v = i; v < j; ++v)
+         t = swapAdjacent(t, v);
+   }
+   return t;
+}
+
+// Drop the leaves the truth table does not depend on; return true if
+// there were any. The truth table is then exact only for the values the
+// leaves can take together, which is all a cut is used for.
+static bool
+minBase(Cut &c)
+{
+   unsigned k = 0;
+   for(unsigned i = 0; i < c._size; ++i){
+      if(!dependsOn(c._truth, i))
+         continue;
+      for(unsigned v = i; v > k; --v)
+         c._truth = swapAdjacent(c._truth, v - 1);
+      c._leaves[k++] = c._leaves[i];
+   }
+   if(k == c._size)
+      return false;
+   c._size = k;
+   c._sign = 0;
+   for(unsigned i = 0; i < k; ++i)
+      c._sign |= 1ULL << (c._leaves[i] & 63);
+   return true;
+}
+
+// Fewer leaves first; ties are broken by the leaves to keep the order
+// independent of the order cuts are found in
+static bool
+cutBetter(const Cut &a, const Cut &b)
+{
+   if(a._size != b._size)
+      return a._size < b._size;
+   for(unsigned i = 0; i < a._size; ++i){
+      if(a._leaves[i] != b._leaves[i])
+         return a._leaves[i] < b._leaves[i];
+   }
+   return false;
+}
+
+/*****************************************/
+/*   Member functions of class CutMgr    */
+/*****************************************/
+TruthTab CutMgr::elemTruth(unsigned i){
+   assert(i < CUT_MAX_LEAVES);
+   return elemTT[i];
+}
+
+// Room for the cuts of "nGates" gates, sized by "nSets" gates holding
+// cuts at once
+void CutMgr::init(unsigned nGates, unsigned k, unsigned nCuts, unsigned nSets){
+   assert(k >= 2 && k <= CUT_MAX_LEAVES);
+   assert(nCuts >= 2 && nCuts <= CUT_MAX_NUM);
+   _k = k;
+   _nCuts = nCuts;
+   vector<Cut>().swap(_pool);
+   _pool.reserve((size_t)nSets * nCuts);
+   _num.clear();
+   _num.reserve(nSets);
+   _slot.assign(nGates, NO_SLOT);
+   _free.clear();
+}
+
+void CutMgr::setLeaf(unsigned g){
+   Cut &c = _pool[newSlot(g) * _nCuts];
+   if(g == 0){
+      c._size = 0;
+      c._sign = 0;
+      c._truth = 0;
+   }
+   else{
+      c._size = 1;
+      c._leaves[0] = g;
+      c._sign = 1ULL << (g & 63);
+      c._truth = elemTT[0];
+   }
+   _num[_slot[g]] = 1;
+}
+
+// Every pair of cuts of the fanins gives a candidate. The best
+// nCuts - 1 candidates that no other one dominates are kept after the
+// trivial cut. The truth table is only computed for a candidate that
+// no other one dominates.
+void CutMgr::computeAnd(unsigned g, unsigned a, unsigned b){
+   unsigned ga = litId(a), gb = litId(b);
+   assert(hasCuts(ga) && hasCuts(gb));
+   _cand.clear();
+   Cut c;
+   for(unsigned i = 0, n = numCuts(ga); i < n; ++i){
+      const Cut &ca = getCut(ga, i);
+      for(unsigned j = 0, m = numCuts(gb); j < m; ++j){
+         const Cut &cb = getCut(gb, j);
+         if((unsigned)__builtin_popcountll(ca._sign | cb._sign) > _k)
+            continue;
+         if(!mergeLeaves(ca, cb, c) || isDominated(c))
+            continue;
+         TruthTab ta = stretch(ca._truth, ca, c), tb = stretch(cb._truth, cb, c);
+         c._truth = (litInv(a) ? ~ta : ta) & (litInv(b) ? ~tb : tb);
+         if(minBase(c) && isDominated(c))
+            continue;
+         addCand(c);
+      }
+   }
+   unsigned s = newSlot(g);
+   Cut *set = &_pool[s * _nCuts];
+   set[0]._size = 1;
+   set[0]._leaves[0] = g;
+   set[0]._sign = 1ULL << (g & 63);
+   set[0]._truth = elemTT[0];
+   for(unsigned i = 0, n = _cand.size(); i < n; ++i)
+      set[i + 1] = _cand[i];
+   _num[s] = _cand.size() + 1;
+}
+
+// Give the cuts of "g" back; its slot goes to the next gate
+void CutMgr::release(unsigned g){
+   if(_slot[g] == NO_SLOT)
+      return ;
+   _free.push_back(_slot[g]);
+   _slot[g] = NO_SLOT;
+}
+
+unsigned CutMgr::newSlot(unsigned g){
+   if(_slot[g] != NO_SLOT)
+      return _slot[g];
+   if(!_free.empty()){
+      _slot[g] = _free.back();
+      _free.pop_back();
+   }
+   else{
+      _slot[g] = _num.size();
+      _num.push_back(0);
+      _pool.resize(_pool.size() + _nCuts);
+   }
+   return _slot[g];
+}
+
+// Leaves of "c" are the union of those of "a" and "b"; false if there
+// are more than k
+bool CutMgr::mergeLeaves(const Cut &a, const Cut &b, Cut &c) const{
+   unsigned i = 0, j = 0, k = 0;
+   while(i < a._size || j < b._size){
+      if(k == _k)
+         return false;
+      if(j == b._size || (i < a._size && a._leaves[i] < b._leaves[j]))
+         c._leaves[k++] = a._leaves[i++];
+      else if(i == a._size || b._leaves[j] < a._leaves[i])
+         c._leaves[k++] = b._leaves[j++];
+      else{
+         c._leaves[k++] = a._leaves[i++];
+         ++j;
+      }
+   }
+   c._size = k;
+   c._sign = a._sign | b._sign;
+   return true;
+}
+
+// True if a candidate has no leaf outside "c"
+bool CutMgr::isDominated(const Cut &c) const{
+   for(unsigned i = 0, n = _cand.size(); i < n; ++i){
+      if(_cand[i].dominates(c))
+         return true;
+   }
+   return false;
+}
+
+// Insert "c" into _cand, which is kept sorted and at most nCuts - 1
+// long, and drop the candidates it dominates. A cut that dominates
+// another has no more leaves, so one ranked after a full list
+// dominates nothing in it.
+void CutMgr::addCand(const Cut &c){
+   unsigned n = _cand.size();
+   if(n == _nCuts - 1 && !cutBetter(c, _cand[n - 1]))
+      return ;
+   unsigned k = 0;
+   for(unsigned i = 0; i < n; ++i){
+      if(!c.dominates(_cand[i]))
+         _cand[k++] = _cand[i];
+   }
+   _cand.resize(k);
+   if(k == _nCuts - 1)
+      _cand.pop_back();
+   unsigned pos = _cand.size();
+   _cand.push_back(c);
+   while(pos > 0 && cutBetter(c, _cand[pos - 1])){
+      _cand[pos] = _cand[pos - 1];
+      --pos;
+   }
+   _cand[pos] = c;
+}
+
+/*******************************************/
+/*   Member functions of class CirMgr      */
+/*******************************************/
+// Priority cuts of every AIG in the DFS cone, in topological order. PIs,
+// undefined gates and const 0 are leaves. The cuts of every gate are
+// kept; a caller that needs them only while walking _dfsList can
+// release() the cuts of a gate once its last fanout is done.
+void CirMgr::enumCuts(CutMgr &cuts, unsigned k, unsigned nCuts){
+	cuts.init(_gateType.size(), k, nCuts, 1 + _nPI + _undefList.size() + _dfsList.size());
+	cuts.setLeaf(0);
+	for(unsigned i = 0; i < _nPI; ++i)
+		cuts.setLeaf(_PIList[i]);
+	for(unsigned i = 0, n = _undefList.size(); i < n; ++i)
+		cuts.setLeaf(_undefList[i]);
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i];
+		if(_gateType[g] == AIG_GATE && inDFS(g))
+			cuts.computeAnd(g, _fanin[0][g], _fanin[1][g]);
+	}
+}
@@ -0,0 +1,94 @@
+/****************************************************************************
+  FileName     [ cirCut.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define k-feasible cuts with truth tables ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2012-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_CUT_H
+#define CIR_CUT_H
+
+#include <vector>
+#include <cassert>
+#include "cirDef.h"
+
+using namespace std;
+
+#define CUT_MAX_LEAVES  6
+#define CUT_MAX_NUM     16
+
+typedef unsigned long long TruthTab;
+
+// A cut of a gate: the gate is a function of the leaves, given by a
+// 64-bit truth table in which leaf i is variable i. Leaves are gate ids
+// in increasing order; a function of fewer than 6 leaves repeats itself
+// over the unused variables. _sign has bit (id % 64) set for each leaf.
+struct Cut
+{
+   unsigned       _leaves[CUT_MAX_LEAVES];
+   unsigned       _size;
+   unsigned long long _sign;
+   TruthTab       _truth;
+
+   // every leaf of this cut is also a leaf of "c"
+   bool dominates(const Cut& c) const {
+      if (_size > c._size || (_sign & c._sign) != _sign) return false;
+      for (unsigned i = 0, j = 0; i < _size; ++i, ++j) {
+         while (j < c._size && c._leaves[j] < _leaves[i]) ++j;
+         if (j == c._size || c._leaves[j] != _leaves[i]) return false;
+      }
+      return true;
+   }
+};
+
+// Priority cuts of the gates of a circuit (see CirMgr::enumCuts()).
+// Each gate holds a fixed-size set of at most "nCuts" cuts of at most "k"
+// leaves, its trivial cut first. The sets live in slots of one pool; a
+// slot given back by release() is reused by the next gate, so a caller
+// that drops the cuts of a gate once its fanouts are done keeps only the
+// cuts on the frontier.
+class CutMgr
+{
+public:
+   CutMgr() : _k(4), _nCuts(8) {}
+   ~CutMgr() {}
+
+   void init(unsigned nGates, unsigned k, unsigned nCuts, unsigned nSets = 0);
+   unsigned cutSize() const { return _k; }
+   unsigned maxCuts() const { return _nCuts; }
+
+   bool hasCuts(unsigned g) const { return _slot[g] != NO_SLOT; }
+   unsigned numCuts(unsigned g) const { return _num[_slot[g]]; }
+   const Cut& getCut(unsigned g, unsigned i) const {
+      assert(i < numCuts(g));
+      return _pool[_slot[g] * _nCuts + i];
+   }
+
+   // "g" gets its trivial cut only (PIs, undefined gates and const 0,
+   // which has no leaves)
+   void setLeaf(unsigned g);
+   // "g" is the AND of literals "a" and "b" whose gates have cuts
+   void computeAnd(unsigned g, unsigned a, unsigned b);
+   void release(unsigned g);
+
+   // truth table of variable i
+   static TruthTab elemTruth(unsigned i);
+
+private:
+   enum { NO_SLOT = ~0u };
+   unsigned          _k;
+   unsigned          _nCuts;
+   vector<Cut>       _pool;
+   IdList            _num;    // cuts in each slot
+   IdList            _slot;   // gate id -> slot
+   IdList            _free;   // released slots
+   vector<Cut>       _cand;   // candidates of the gate being computed
+
+   unsigned newSlot(unsigned g);
+   bool mergeLeaves(const Cut&, const Cut&, Cut&) const;
+   bool isDominated(const Cut&) const;
+   void addCand(const Cut&);
+};
+
+#endif // CIR_CUT_H
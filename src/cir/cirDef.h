@@ -16,15 +16,33 @@ using namespace std;
 
 // TODO: define your own typedef or enum
 
-class CirGate;
+#define WORD_SIZE   (sizeof(size_t) * 8)
+// number of simulation words per gate; set by -DSIM_WORDS in make.cir
+#ifndef SIM_WORDS
+#define SIM_WORDS   8
+#endif
+#if SIM_WORDS != 4 && SIM_WORDS != 8 && SIM_WORDS != 16
+#error "SIM_WORDS must be 4, 8 or 16"
+#endif
+
 class CirMgr;
 class SatSolver;
+class AigHash;
+class CutMgr;
+struct Cut;
 
-class SimKey;
-
-typedef vector<CirGate*>           GateList;
 typedef vector<unsigned>           IdList;
-typedef vector<SimKey*>            FecGroup;
+
+// One instruction of the compiled simulation program (see CirMgr::compileSim)
+// val[_out] = (val[_in0] ^ inv0) & (val[_in1] ^ inv1); operands are slots
+// bit 0 / bit 1 of _inv tell if _in0 / _in1 is inverted
+struct SimInst
+{
+   unsigned _out;
+   unsigned _in0;
+   unsigned _in1;
+   unsigned _inv;
+};
 
 enum GateType
 {
@@ -34,7 +52,7 @@ enum GateType
    AIG_GATE   = 3,
    CONST_GATE = 4,
 
-   TOT_GATE
+   TOT_GATE         // also marks an id without a gate
 };
 
 #endif // CIR_DEF_H
@@ -10,7 +10,8 @@
 #include "cirMgr.h"
 #include "cirGate.h"
 #include "sat.h"
-#include "myHashMap.h"
+#include "cirHash.h"
+#include "cirSimd.h"
 #include "util.h"
 
 using namespace std;
@@ -21,6 +22,18 @@ using namespace std;
 /*******************************/
 /*   Global variable and enum  */
 /*******************************/
+// gates in the fanin window of a resubstituted gate
+#define RESUB_WIN    64
+// divisor literals tried in pairs
+#define RESUB_PAIRS  32
+// refuted or undecided candidates before a gate is given up
+#define RESUB_FAILS  2
+// conflicts allowed to each SAT call of resubstitution; a call that runs
+// out decides nothing
+#define RESUB_CONFLICTS  100
+// SAT calls before the resubstitution solver is built anew
+#define RESUB_REBUILD    100
+#define RESUB_NONE   (~0u)
 
 /**************************************/
 /*   Static varaibles and functions   */
@@ -31,59 +44,419 @@ using namespace std;
 /*******************************************/
 // _floatList may be changed.
 // _unusedList and _undefList won't be changed
+// The first of equal gates in DFS order is kept. A merged gate shares
+// its fanins with the kept one, so removing it leaves the DFS order
+// exact and no traversal is needed afterwards.
 void
 CirMgr::strash()
 {
-	HashMap<HashKey, CirGate *> hash(_maxVarId);
-	CirGate *matchGate;
+	if(!_dfsExact)
+		updateDFS();
+	AigHash hash(_nAIG);
 	for(size_t s = 0, n = _dfsList.size(); s < n; ++s){
-		if(_dfsList[s]->getType() != AIG_GATE || _dfsList[s]->_undefined)
+		unsigned g = _dfsList[s];
+		if(_gateType[g] != AIG_GATE || isUndef(g) || !inDFS(g))
 			continue;
-		HashKey key(_dfsList[s]->_faninList[0](), _dfsList[s]->_faninList[1]());
-		matchGate = hash.search(key);
+		unsigned matchGate = hash.insert(findRepr(_fanin[0][g]), findRepr(_fanin[1][g]), g);
 		if(matchGate)
-			mergeGates(_dfsList[s], matchGate); // order matters!!!
-		else
-			hash.push(key, _dfsList[s]);
+			mergeGates(g, matchGate); // order matters!!!
 	}
-	updateDFS();
+	applyMerges();
+	compactDFS();
 }
 
+// Prove FEC candidates with a single incremental SAT solver.
+// Every query adds an XOR miter on top of the same proof model, so
+// clauses learnt from earlier queries stay valid for the later ones.
+// The model is encoded lazily: a gate gets its variable and clauses only
+// when a query first reaches its fanin cone.
+// Counter-examples are packed into one word per PI; every WORD_SIZE of
+// them are simulated to split all FEC groups they distinguish at once.
+// Gates are merged into the representative that comes first in DFS order.
 void
 CirMgr::fraig()
 {
+	SatSolver solver;
+	solver.initialize();
+	_satVar.assign(_gateType.size(), var_Undef);
+	_satVar[0] = solver.newVar();
+	solver.assertProperty(_satVar[0], false);
+
+	vector<size_t> pats(_nPI);
+	unsigned nPat = 0;
+	for(unsigned j = 0; j < _nPI; ++j)
+		pats[j] = _simGen();
+
+	// gates already visited and kept; they are the representatives
+	vector<bool> done(_gateType.size(), false);
+	done[0] = true;
+	vector<int> grpOf;
+	vector<bool> invOf;
+	vector<IdList> reps;
+	collectReps(done, grpOf, invOf, reps);
+
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i];
+		if(_gateType[g] != AIG_GATE || !inDFS(g) || grpOf[g] < 0)
+			continue;
+		int grp = grpOf[g];
+		bool merged = false, full = false;
+		for(size_t s = 0; s < reps[grp].size() && !merged && !full; ++s){
+			unsigned r = reps[grp][s];
+			bool inv = (invOf[r] != invOf[g]);
+			if(proveEq(solver, r, g, inv) == l_True){
+				mergeGates(g, r, inv, "Fraig");
+				merged = true;
+			}
+			else{
+				recordCex(solver, pats, nPat);
+				full = (++nPat == WORD_SIZE);
+			}
+		}
+		if(!merged && !full){
+			done[g] = true;
+			reps[grp].push_back(g);
+		}
+
+		if(full){
+			// counter-examples go to the first word, random patterns to the rest
+			patternGen();
+			for(unsigned j = 0; j < _nPI; ++j){
+				simVal(_PIList[j])[0] = pats[j];
+				pats[j] = _simGen();
+			}
+			nPat = 0;
+			simulate();
+			divideGrps();
+			collectReps(done, grpOf, invOf, reps);
+			cout << "Updating by SAT... Total #FEC Group = " << numFecGrps() << endl;
+			if(!merged) // check g again against the refined group
+				--i;
+		}
+	}
+	_fecLits.clear();
+	_fecBegin.clear();
+	applyMerges();
+	if(compactDFS())
+		_dfsExact = false;
+	updateOpen();
+}
+
+// Replace each AIG by a gate of its fanin window, or by the AND of two
+// of them, when the signatures of one round of random simulation agree
+// and SAT proves it. The gates only it used within the window (its MFFC)
+// are saved; an AND costs one new gate. The window lies before the gate
+// in topological order, so no replacement closes a cycle.
+// Each SAT call stops after RESUB_CONFLICTS conflicts, which counts as a
+// failed candidate, and the solver is built anew every RESUB_REBUILD
+// calls, so neither a single gate nor the growing clause database can
+// stall the pass. Counter-examples of refuted candidates are simulated
+// a word at a time, as in fraig(). The replaced MFFCs are swept at the
+// end.
+void
+CirMgr::resub()
+{
+	if(!_dfsExact)
+		updateDFS();
+	vector<bool> wasOut;
+	outOfDFS(wasOut);
+	unsigned oldAig = _nAIG;
+	patternGen();
+	simulate();
+	SatSolver solver;
+	unsigned nCall = RESUB_REBUILD;
+
+	vector<size_t> pats(_nPI);
+	unsigned nPat = 0, nOld = _gateType.size();
+	for(unsigned j = 0; j < _nPI; ++j)
+		pats[j] = _simGen();
+
+	IdList win, leaves, divs;
+	unsigned nSub = 0;
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i];
+		if(_gateType[g] != AIG_GATE || isUndef(g) || !inDFS(g))
+			continue;
+		if(nCall >= RESUB_REBUILD){
+			solver.initialize();
+			_satVar.assign(_gateType.size(), var_Undef);
+			_satVar[0] = solver.newVar();
+			solver.assertProperty(_satVar[0], false);
+			nCall = 0;
+		}
+		resubWindow(g, win, leaves);
+		unsigned mffc = mffcSize(g, leaves);
+		divs.assign(1, 0);
+		for(unsigned k = 0, m = win.size(); k < m; ++k){
+			if(win[k] && !isMarked(win[k]))
+				divs.push_back(win[k]);
+		}
+		unsigned lit = resubFind(solver, g, divs, mffc, pats, nPat, nCall);
+		if(lit != RESUB_NONE){
+			dfsReplace(g, litId(lit));
+			mergeInto(g, lit);
+			++nSub;
+		}
+		if(nPat >= WORD_SIZE - RESUB_FAILS){
+			// counter-examples go to the first word, random patterns to the
+			// rest; new gates are not in the program and follow their fanins
+			patternGen();
+			for(unsigned j = 0; j < _nPI; ++j){
+				simVal(_PIList[j])[0] = pats[j];
+				pats[j] = _simGen();
+			}
+			nPat = 0;
+			simulate();
+			for(unsigned ng = nOld, m = _gateType.size(); ng < m; ++ng)
+				simAnd(simVal(ng), getSimVal(litId(_fanin[0][ng])), SIM_MASK(litInv(_fanin[0][ng])),
+				       getSimVal(litId(_fanin[1][ng])), SIM_MASK(litInv(_fanin[1][ng])));
+		}
+	}
+	applyMerges();
+	sweepReplaced(wasOut);
+	updateDFS();
+	cout << "Resubstitution: " << nSub << " gates replaced, AIGs " << oldAig
+	     << " -> " << _nAIG << "...\n";
 }
 
 /********************************************/
 /*   Private member functions about fraig   */
 /********************************************/
-void CirMgr::mergeGates(CirGate *const &first, CirGate *const &second){
-	cout << "Strashing: " << second->_id << " merging " << first->_id << "...\n";
-	// disconnect fanins of first
-	CirGate *temp;
-	for(int i = 0; i < 2; ++i){
-		temp = first->_faninList[i].gate();
-		for(size_t s = 0; s < temp->_fanoutList.size(); ++s){
-			if(temp->_fanoutList[s] == first){
-				temp->_fanoutList.erase(temp->_fanoutList.begin() + s);
-				break;
+// Hash-consing AND constructor: return the literal of (a & b). Constant,
+// equal and complementary fanins are folded, and an AND already in
+// "hash" is reused; otherwise "gid" gets the two fanins and is entered
+// in "hash". The fanout lists are left to the caller.
+unsigned CirMgr::createAnd(unsigned gid, unsigned a, unsigned b, AigHash &hash){
+	if(a == 0 || b == 0 || a == (b ^ 1))
+		return 0;
+	if(a == 1)
+		return b;
+	if(b == 1 || a == b)
+		return a;
+	unsigned g = hash.find(a, b);
+	if(g)
+		return makeLit(g, false);
+	setFanin(gid, 0, a);
+	setFanin(gid, 1, b);
+	hash.insert(a, b, gid);
+	return makeLit(gid, false);
+}
+
+void CirMgr::mergeGates(unsigned first, unsigned second, bool inv, const char *msg){
+	cout << msg << ": " << second << " merging " << (inv ? "!" : "") << first << "...\n";
+	dfsReplace(first, second);
+	mergeInto(first, makeLit(second, inv));
+}
+
+// Return the SAT variable of g, encoding its fanin cone on first use;
+// undefined gates share the variable of const 0
+Var CirMgr::genCNF(SatSolver &solver, unsigned root){
+	IdList stack(1, root);
+	while(!stack.empty()){
+		unsigned g = stack.back();
+		if(_satVar[g] != var_Undef){
+			stack.pop_back();
+			continue;
+		}
+		if(isUndef(g))
+			_satVar[g] = _satVar[0];
+		else if(_gateType[g] == PI_GATE)
+			_satVar[g] = solver.newVar();
+		else{
+			// fanins first, in order, so variables are numbered as in a DFS
+			unsigned in0 = findRepr(_fanin[0][g]), in1 = findRepr(_fanin[1][g]);
+			Var v0 = _satVar[litId(in0)], v1 = _satVar[litId(in1)];
+			if(v0 == var_Undef){
+				stack.push_back(litId(in0));
+				continue;
 			}
+			if(v1 == var_Undef){
+				stack.push_back(litId(in1));
+				continue;
+			}
+			_satVar[g] = solver.newVar();
+			solver.addAigCNF(_satVar[g], v0, litInv(in0), v1, litInv(in1));
+		}
+		stack.pop_back();
+	}
+	return _satVar[root];
+}
+
+// Rebuild the group index of each gate and the representatives of each
+// group from the gates that have been visited
+void CirMgr::collectReps(const vector<bool> &done, vector<int> &grpOf,
+                         vector<bool> &invOf, vector<IdList> &reps){
+	grpOf.assign(_gateType.size(), -1);
+	invOf.assign(_gateType.size(), false);
+	reps.assign(numFecGrps(), IdList());
+	for(unsigned i = 0, n = numFecGrps(); i < n; ++i){
+		for(unsigned j = _fecBegin[i]; j < _fecBegin[i + 1]; ++j){
+			unsigned id = _fecLits[j] >> 1;
+			grpOf[id] = i;
+			invOf[id] = _fecLits[j] & 1;
+			if(done[id])
+				reps[i].push_back(id);
+		}
+	}
+}
+
+// Store the PI assignment of the last SAT model in bit "pos" of pats;
+// PIs outside the proven cones keep their random bits
+void CirMgr::recordCex(const SatSolver &solver, vector<size_t> &pats, unsigned pos){
+	size_t mask = (size_t)1 << pos;
+	for(unsigned j = 0; j < _nPI; ++j){
+		Var v = _satVar[_PIList[j]];
+		if(v == var_Undef)
+			continue;
+		if(solver.getValue(v) == 1)
+			pats[j] |= mask;
+		else
+			pats[j] &= ~mask;
+	}
+}
+
+// l_True if "a == b ^ inv" holds for all input assignments, l_False if
+// the model is a counter-example, l_Undef if "nConf" conflicts (when not
+// negative) pass first
+lbool CirMgr::proveEq(SatSolver &solver, unsigned a, unsigned b, bool inv, int nConf){
+	Var va = genCNF(solver, a), vb = genCNF(solver, b);
+	return proveVars(solver, va, vb, inv, nConf);
+}
+
+lbool CirMgr::proveVars(SatSolver &solver, Var va, Var vb, bool inv, int nConf){
+	Var f = solver.newVar();
+	solver.addXorCNF(f, va, false, vb, inv);
+	solver.assumeRelease();
+	solver.assumeProperty(f, true);
+	lbool res = solver.assumpSolve(nConf);
+	if(res == l_True)
+		return l_False;
+	if(res == l_Undef)
+		return l_Undef;
+	// the miter is proven constant; let the solver drop its clauses
+	solver.assertProperty(f, false);
+	return l_True;
+}
+
+// The fanin cone of "g" in breadth-first order, in "win", up to about
+// RESUB_WIN gates; the gates it stops at also go to "leaves"
+void CirMgr::resubWindow(unsigned g, IdList &win, IdList &leaves){
+	win.clear();
+	leaves.clear();
+	newMark();
+	setMark(g);
+	IdList queue(1, g);
+	for(unsigned k = 0; k < queue.size(); ++k){
+		for(int i = 0; i < 2; ++i){
+			unsigned f = litId(findRepr(_fanin[i][queue[k]]));
+			if(isMarked(f))
+				continue;
+			setMark(f);
+			win.push_back(f);
+			if(_gateType[f] == AIG_GATE && !isUndef(f) && win.size() < RESUB_WIN)
+				queue.push_back(f);
+			else
+				leaves.push_back(f);
+		}
+	}
+}
+
+// Literal to replace "g" with, among the divisors "divs" (const 0 first):
+// a divisor, which saves the MFFC, or the AND of two divisor literals if
+// the MFFC has two gates or more to make up for it. The AND becomes a new
+// gate, with its signature and SAT variable. RESUB_NONE if nothing is
+// proven. Each refutation adds a pattern to "pats", and its values join
+// the signatures for the candidates after it; "nCall" counts SAT calls.
+unsigned CirMgr::resubFind(SatSolver &solver, unsigned g, const IdList &divs,
+                           unsigned mffc, vector<size_t> &pats, unsigned &nPat,
+                           unsigned &nCall){
+	unsigned nFail = 0, nCex = 0, cexG = 0;
+	IdList cexD(divs.size(), 0);
+	for(unsigned k = 0, m = divs.size(); k < m; ++k){
+		const size_t *sg = getSimVal(g), *sd = getSimVal(divs[k]);
+		bool inv = !simEqual(sg, 0, sd, 0);
+		if(inv && !simEqual(sg, 0, sd, ~size_t(0)))
+			continue;
+		unsigned cexMask = (1u << nCex) - 1;
+		if(((cexD[k] ^ (inv ? ~0u : 0u)) & cexMask) != cexG)
+			continue;
+		++nCall;
+		lbool res = proveEq(solver, divs[k], g, inv, RESUB_CONFLICTS);
+		if(res == l_True)
+			return makeLit(divs[k], inv);
+		if(res == l_False){
+			recordCex(solver, pats, nPat++);
+			resubCex(solver, g, divs, cexG, cexD, nCex++);
 		}
+		if(++nFail == RESUB_FAILS)
+			return RESUB_NONE;
 	}
-	// connect fanouts of first to second
-	for(size_t s = 0; s < first->_fanoutList.size(); ++s){
-		temp = first->_fanoutList[s];
-		for(size_t t = 0; t < temp->_faninList.size(); ++t){
-			if(temp->_faninList[t].gate() == first){
-				temp->_faninList[t] = CirGateV(second, temp->_faninList[t].isInv());
-				second->_fanoutList.push_back(temp);
-				break;
+	if(mffc < 2)
+		return RESUB_NONE;
+	// g ^ inv == x & y: x and y must both cover g ^ inv
+	unsigned in0 = findRepr(_fanin[0][g]), in1 = findRepr(_fanin[1][g]);
+	IdList cand, candK;
+	for(int inv = 0; inv < 2; ++inv){
+		size_t mg = SIM_MASK(inv);
+		cand.clear();
+		candK.clear();
+		for(unsigned k = 1, m = divs.size(); k < m && cand.size() < RESUB_PAIRS; ++k){
+			for(int p = 0; p < 2; ++p){
+				if(simImplies(getSimVal(g), mg, getSimVal(divs[k]), SIM_MASK(p))){
+					cand.push_back(makeLit(divs[k], p));
+					candK.push_back(k);
+				}
+			}
+		}
+		for(unsigned a = 0, m = cand.size(); a < m; ++a){
+			for(unsigned b = a + 1; b < m; ++b){
+				unsigned x = cand[a], y = cand[b];
+				if(litId(x) == litId(y) ||
+				   (!inv && ((x == in0 && y == in1) || (x == in1 && y == in0))))
+					continue;
+				if(!simEqualAnd(getSimVal(g), mg, getSimVal(litId(x)), SIM_MASK(litInv(x)),
+				                getSimVal(litId(y)), SIM_MASK(litInv(y))))
+					continue;
+				unsigned cexMask = (1u << nCex) - 1;
+				unsigned cx = cexD[candK[a]] ^ (litInv(x) ? ~0u : 0u);
+				unsigned cy = cexD[candK[b]] ^ (litInv(y) ? ~0u : 0u);
+				if((cx & cy & cexMask) != ((cexG ^ (inv ? ~0u : 0u)) & cexMask))
+					continue;
+				++nCall;
+				Var vx = genCNF(solver, litId(x)), vy = genCNF(solver, litId(y));
+				Var vg = genCNF(solver, g), t = solver.newVar();
+				solver.addAigCNF(t, vx, litInv(x), vy, litInv(y));
+				lbool res = proveVars(solver, t, vg, inv, RESUB_CONFLICTS);
+				if(res == l_True){
+					unsigned ng = newAig(x, y), slot = _simVals.size() / SIM_WORDS;
+					_satVar.push_back(t);
+					_simVals.resize(_simVals.size() + SIM_WORDS);
+					_simSlot[ng] = slot;
+					simAnd(&_simVals[slot * SIM_WORDS], getSimVal(litId(x)), SIM_MASK(litInv(x)),
+					       getSimVal(litId(y)), SIM_MASK(litInv(y)));
+					return makeLit(ng, inv);
+				}
+				if(res == l_False){
+					recordCex(solver, pats, nPat++);
+					resubCex(solver, g, divs, cexG, cexD, nCex++);
+				}
+				if(++nFail == RESUB_FAILS)
+					return RESUB_NONE;
 			}
 		}
 	}
-	// delete first
-	unsigned index = first->_id;
-	delete _gates[index];
-	_gates[index] = 0;
-	--_nAIG;
-}
\ No newline at end of file
+	return RESUB_NONE;
+}
+
+// Set bit "bit" of "cexG" and of each "cexD" to the value of g and of
+// each divisor in the last model; the divisors lie in the cone of g, so
+// all of them have a variable
+void CirMgr::resubCex(const SatSolver &solver, unsigned g, const IdList &divs,
+                      unsigned &cexG, IdList &cexD, unsigned bit){
+	if(solver.getValue(_satVar[g]) == 1)
+		cexG |= 1u << bit;
+	for(unsigned k = 0, m = divs.size(); k < m; ++k){
+		if(solver.getValue(_satVar[divs[k]]) == 1)
+			cexD[k] |= 1u << bit;
+	}
+}
@@ -1,7 +1,7 @@
 /****************************************************************************
 	FileName     [ cirGate.cpp ]
 	PackageName  [ cir ]
-	Synopsis     [ Define class CirAigGate member functions ]
+	Synopsis     [ Define the AIG store and gate reporting of CirMgr ]
 	Author       [ Chung-Yang (Ric) Huang ]
 	Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
 ****************************************************************************/
@@ -17,47 +17,251 @@
 
 using namespace std;
 
-// TODO: Keep "CirGate::reportGate()", "CirGate::reportFanin()" and
-//       "CirGate::reportFanout()" for cir cmds. Feel free to define
+// TODO: Keep "CirMgr::reportGate()", "CirMgr::reportFanin()" and
+//       "CirMgr::reportFanout()" for cir cmds. Feel free to define
 //       your own variables and functions.
 
 extern CirMgr *cirMgr;
-unsigned CirGate::_globalTraversed = 0;
 
-/**************************************/
-/*   class CirGate member functions   */
-/**************************************/
+/*****************************************/
+/*   AIG store of class CirMgr           */
+/*****************************************/
+// "n" ids, all without a gate except const 0; room for "nEdge" fanouts
+// is taken from the heap at once
+void CirMgr::initStore(unsigned n, unsigned nEdge){
+	_gateType.assign(n, TOT_GATE);
+	_gateFlag.assign(n, 0);
+	_fanin[0].assign(n, 0);
+	_fanin[1].assign(n, 0);
+	_gateLine.assign(n, 0);
+	_level.assign(n, 0);
+	_fanouts.init(n, nEdge);
+	_repr.resize(n);
+	for(unsigned i = 0; i < n; ++i)
+		_repr[i] = makeLit(i, false);
+	_mergeLog.clear();
+	_gateName.clear();
+	_mark.assign(n, 0);
+	_markStamp = 0;
+	_optDirty.clear();
+	_optAll = true;
+	newGate(0, CONST_GATE);
+}
+
+void CirMgr::newGate(unsigned gid, GateType type, unsigned line){
+	_gateType[gid] = type;
+	_gateFlag[gid] = 0;
+	_gateLine[gid] = line;
+}
+
+// Append an AIG of literals "a" and "b" to the store. It is out of the
+// DFS cone until something refers to it (see dfsRef()).
+unsigned CirMgr::newAig(unsigned a, unsigned b){
+	unsigned g = _gateType.size();
+	_gateType.push_back(AIG_GATE);
+	_gateFlag.push_back(0);
+	_fanin[0].push_back(0);
+	_fanin[1].push_back(0);
+	_gateLine.push_back(0);
+	_level.push_back(0);
+	_fanouts.resize(g + 1);
+	_repr.push_back(makeLit(g, false));
+	_mark.push_back(0);
+	_dfsRef.push_back(0);
+	_dfsPos.push_back(0);
+	_simSlot.push_back(0);
+	connect(g, 0, a);
+	connect(g, 1, b);
+	++_nAIG;
+	return g;
+}
+
+// The gate must be disconnected already
+void CirMgr::removeGate(unsigned gid){
+	_gateType[gid] = TOT_GATE;
+	_gateFlag[gid] = 0;
+	_fanouts.release(gid);
+	_gateName.erase(gid);
+}
+
+unsigned CirMgr::faninNum(unsigned gid) const{
+	if(_gateType[gid] == PO_GATE)
+		return 1;
+	if(_gateType[gid] == AIG_GATE && !isUndef(gid))
+		return 2;
+	return 0;
+}
+
+// Make "lit" the i-th fanin of gate "gid"
+void CirMgr::connect(unsigned gid, int i, unsigned lit){
+	setFanin(gid, i, lit);
+	_fanouts.push(litId(lit), gid);
+}
+
+// Change a fanin without touching the fanout lists; the gate is queued
+// for the next optimize()
+void CirMgr::setFanin(unsigned gid, int i, unsigned lit){
+	_fanin[i][gid] = lit;
+	if(!_optAll && !(_gateFlag[gid] & GATE_OPTDIRTY)){
+		_gateFlag[gid] |= GATE_OPTDIRTY;
+		_optDirty.push_back(gid);
+	}
+}
+
+/*****************************************/
+/*   Pending merges                      */
+/*****************************************/
+// Merges are recorded in _repr, a union-find with phase: a merged gate
+// points at the literal it was merged into. Fanins are read through
+// findRepr() until applyMerges() rewires the store once. A gate is only
+// merged into a gate that is kept, so the chains stay short.
+
+// Literal that "lit" stands for under the pending merges; the path is
+// compressed on the way
+unsigned CirMgr::findRepr(unsigned lit){
+	unsigned r = lit;
+	while(isMerged(litId(r)))
+		r = _repr[litId(r)] ^ litInv(r);
+	while(litId(lit) != litId(r)){
+		unsigned next = _repr[litId(lit)] ^ litInv(lit);
+		_repr[litId(lit)] = r ^ litInv(lit);
+		lit = next;
+	}
+	return r;
+}
+
+// Gate "gid" computes "lit" from now on. It stays in the store, out of
+// the DFS cone, until applyMerges().
+void CirMgr::mergeInto(unsigned gid, unsigned lit){
+	_repr[gid] = findRepr(lit);
+	_mergeLog.push_back(gid);
+	--_nAIG;
+}
+
+// Apply the pending merges in one pass: fanins are redirected to their
+// representatives, merged gates are removed and the fanout lists are
+// rebuilt. A list keeps its entries whose fanouts survive, followed by
+// those of the gates merged into it in merge order, which is the order
+// rewiring each merge at once would give.
+void CirMgr::applyMerges(){
+	if(_mergeLog.empty())
+		return ;
+	unsigned n = _gateType.size();
+	// gates merged into each gate, grouped by representative
+	IdList mBegin(n + 1, 0), mList(_mergeLog.size());
+	for(unsigned i = 0, m = _mergeLog.size(); i < m; ++i)
+		++mBegin[litId(findRepr(makeLit(_mergeLog[i], false))) + 1];
+	for(unsigned g = 0; g < n; ++g)
+		mBegin[g + 1] += mBegin[g];
+	IdList fill(mBegin.begin(), mBegin.end() - 1);
+	for(unsigned i = 0, m = _mergeLog.size(); i < m; ++i)
+		mList[fill[litId(_repr[_mergeLog[i]])]++] = _mergeLog[i];
+
+	// new fanout lists in CSR form
+	IdList foBegin(n + 1, 0), foList;
+	for(unsigned g = 0; g < n; ++g){
+		foBegin[g] = foList.size();
+		if(!hasGate(g) || isMerged(g))
+			continue;
+		for(unsigned k = mBegin[g]; k <= mBegin[g + 1]; ++k){
+			unsigned src = (k == mBegin[g] ? g : mList[k - 1]);
+			for(unsigned s = 0, m = _fanouts.size(src); s < m; ++s){
+				unsigned fo = _fanouts(src, s);
+				if(hasGate(fo) && !isMerged(fo))
+					foList.push_back(fo);
+			}
+		}
+	}
+	foBegin[n] = foList.size();
+
+	for(unsigned g = 0; g < n; ++g){
+		if(!hasGate(g) || isMerged(g))
+			continue;
+		for(unsigned i = 0, m = faninNum(g); i < m; ++i){
+			unsigned lit = findRepr(_fanin[i][g]);
+			if(lit != _fanin[i][g])
+				setFanin(g, i, lit);
+		}
+	}
+	_fanouts.init(n, foList.size());
+	for(unsigned g = 0; g < n; ++g){
+		_fanouts.reserve(g, foBegin[g + 1] - foBegin[g]);
+		for(unsigned s = foBegin[g]; s < foBegin[g + 1]; ++s)
+			_fanouts.push(g, foList[s]);
+	}
+	for(unsigned i = 0, m = _mergeLog.size(); i < m; ++i){
+		removeGate(_mergeLog[i]);
+		_repr[_mergeLog[i]] = makeLit(_mergeLog[i], false);
+	}
+	_mergeLog.clear();
+}
+
+string
+CirMgr::getTypeStr(unsigned gid) const
+{
+	switch(_gateType[gid]){
+		case PI_GATE:    return "PI";
+		case PO_GATE:    return "PO";
+		case CONST_GATE: return "CONST";
+		case AIG_GATE:   return isUndef(gid) ? "UNDEF" : "AIG";
+		default:         return "";
+	}
+}
+
+/********************************************/
+/*   Gate reporting functions of CirMgr     */
+/********************************************/
 void
-CirGate::reportGate() const
+CirMgr::printGate(unsigned gid) const
+{
+	map<unsigned, string>::const_iterator name = _gateName.find(gid);
+	switch(_gateType[gid]){
+		case CONST_GATE:
+			cout << "CONST0\n";
+			return;
+		case PI_GATE:
+			cout << "PI  " << gid;
+			break;
+		case PO_GATE:
+		case AIG_GATE:
+			cout << (_gateType[gid] == PO_GATE ? "PO  " : "AIG ") << gid;
+			for(unsigned i = 0, n = faninNum(gid); i < n; ++i){
+				unsigned lit = _fanin[i][gid];
+				cout << ' ';
+				if(isUndef(litId(lit)))
+					cout << '*';
+				if(litInv(lit))
+					cout << '!';
+				cout << litId(lit);
+			}
+			break;
+		default:
+			return;
+	}
+	if(name != _gateName.end())
+		cout << " (" << name->second << ')';
+	cout << endl;
+}
+
+void
+CirMgr::reportGate(unsigned gid) const
 {
 	for(int i = 0; i < 80; ++i)
 		cout << '=';
-	cout << "\n= " << getTypeStr() << '(' << _id << ')';
-	if(_name.size())
-		cout << '\"' << _name << '\"';
-	cout << ", line " << _line;
+	cout << "\n= " << getTypeStr(gid) << '(' << gid << ')';
+	map<unsigned, string>::const_iterator name = _gateName.find(gid);
+	if(name != _gateName.end())
+		cout << '\"' << name->second << '\"';
+	cout << ", line " << _gateLine[gid];
 	// fec groups
 	cout << "\n= FECs:";
-	for(unsigned i = 0, n = cirMgr->_fecGrps.size(); i < n; ++i){
-		for(unsigned j = 0, m = cirMgr->_fecGrps[i].size(); j < m; ++j){
-			if(_id == cirMgr->_fecGrps[i][j]->_id){
-				for(unsigned k = 0, l = cirMgr->_fecGrps[i].size(); k < l; ++k){
-					if(k == j)
-						continue;
-					cout << ' ';
-					if(cirMgr->_fecGrps[i][k]->_inv != cirMgr->_fecGrps[i][j]->_inv)
-						cout << '!';
-					cout << cirMgr->_fecGrps[i][k]->_id;
-				}
-				break;
-			}
-		}
-	}
+	printGateFECs(gid);
 
-	// simulation value
+	// simulation value (the first word of the last simulation)
+	size_t value = getSimVal(gid)[0];
 	cout << "\n= Value: ";
 	for(unsigned i = 0, n = sizeof(size_t) * 8; i < n; ++i){
-		cout << ((_value >> (n - i - 1)) & 1);
+		cout << ((value >> (n - i - 1)) & 1);
 		if(i % 8 == 7 && i != n - 1)
 			cout << '_';
 	}
@@ -69,76 +273,87 @@ CirGate::reportGate() const
 }
 
 void
-CirGate::reportFanin(int level) const
+CirMgr::reportFanin(unsigned gid, int level) const
 {
 	assert (level >= 0);
-	cout << getTypeStr() << ' ' << _id << endl;
-	if(level == 0)
-		return ;
-
-	int curLevel = 1;
-	++CirGate::_globalTraversed;
-	for(size_t s = 0; s < _faninList.size(); ++s)
-		printFanin(_faninList[s].gate(), _faninList[s].isInv(), curLevel, level);
+	newMark();
+	printFanin(gid, level);
 }
 
 void
-CirGate::reportFanout(int level) const
+CirMgr::reportFanout(unsigned gid, int level) const
 {
 	assert (level >= 0);
-	cout << getTypeStr() << ' ' << _id << endl;
-	if(level == 0)
-		return ;
-
-	int curLevel = 1;
-	++CirGate::_globalTraversed;
-	for(size_t s = 0; s < _fanoutList.size(); ++s)
-		printFanout(this, _fanoutList[s], curLevel, level);
+	newMark();
+	printFanout(gid, level);
 }
 
-void CirGate::printFanin(CirGate *const &g, bool inv, int &curLevel, int &level) const{
-	 // print
-	 for(int i = 0; i < curLevel; ++i)
-		 cout << "  ";
-	 if(inv)
+// Both reports walk the cone of "root" in pre-order with an explicit stack
+// of (gate, next edge); the depth of a line is the stack size. A gate is
+// expanded once; later visits within the depth limit end with " (*)".
+void CirMgr::printFanin(unsigned root, int level) const{
+	vector< pair<unsigned, unsigned> > stack;
+	unsigned g = root;
+	bool inv = false;
+	while(true){
+		// print
+		int curLevel = stack.size();
+		for(int i = 0; i < curLevel; ++i)
+			cout << "  ";
+		if(inv)
 			cout << '!';
-	 cout << g->getTypeStr() << ' ' << g->_id;
-	 if(g->_traversed == _globalTraversed && curLevel < level && !g->_undefined)
+		cout << getTypeStr(g) << ' ' << g;
+		if(isMarked(g) && curLevel < level && !isUndef(g))
 			cout << " (*)";
-	 cout << endl;
+		cout << endl;
 
-	 // traverse
-	 if(curLevel == level || g->_traversed == _globalTraversed)
+		// traverse
+		if(curLevel < level && !isMarked(g)){
+			setMark(g);
+			stack.push_back(make_pair(g, 0u));
+		}
+		while(!stack.empty() && stack.back().second == faninNum(stack.back().first))
+			stack.pop_back();
+		if(stack.empty())
 			return ;
-	 g->_traversed = _globalTraversed;
-	 ++curLevel;
-	 for(size_t s = 0; s < g->_faninList.size(); ++s)
-			printFanin(g->_faninList[s].gate(), g->_faninList[s].isInv(), curLevel, level);
-	 --curLevel;
-}
-
-void CirGate::printFanout(const CirGate *pre, CirGate *const &cur, int &curLevel, int &level) const{
-	 // print
-	 for(int i = 0; i < curLevel; ++i)
-		 cout << "  ";
-	 for(size_t s = 0; s < cur->_faninList.size(); ++s){
-			if(cur->_faninList[s].gate() == pre){
-				 if(cur->_faninList[s].isInv())
-						cout << '!';
-				 cout << cur->getTypeStr() << ' ' << cur->_id;
-				 if(cur->_traversed == _globalTraversed && curLevel < level && !cur->_unused)
-						cout << " (*)";
-				 cout << endl;
-				 break;
+		unsigned lit = _fanin[stack.back().second++][stack.back().first];
+		g = litId(lit);
+		inv = litInv(lit);
+	}
+}
+
+void CirMgr::printFanout(unsigned root, int level) const{
+	const FanoutIndex &fos = fanoutIndex();
+	vector< pair<unsigned, unsigned> > stack;
+	unsigned cur = root;
+	while(true){
+		// print
+		int curLevel = stack.size();
+		for(int i = 0; i < curLevel; ++i)
+			cout << "  ";
+		if(curLevel == 0)
+			cout << getTypeStr(cur) << ' ' << cur << endl;
+		for(unsigned i = 0, n = (curLevel ? faninNum(cur) : 0); i < n; ++i){
+			if(litId(_fanin[i][cur]) == stack.back().first){
+				if(litInv(_fanin[i][cur]))
+					cout << '!';
+				cout << getTypeStr(cur) << ' ' << cur;
+				if(isMarked(cur) && curLevel < level && !(_gateFlag[cur] & GATE_UNUSED))
+					cout << " (*)";
+				cout << endl;
+				break;
 			}
-	 }
+		}
 
-	 // traverse
-	 if(curLevel == level || cur -> _traversed == _globalTraversed)
+		// traverse
+		if(curLevel < level && !isMarked(cur)){
+			setMark(cur);
+			stack.push_back(make_pair(cur, 0u));
+		}
+		while(!stack.empty() && stack.back().second == fos.size(stack.back().first))
+			stack.pop_back();
+		if(stack.empty())
 			return ;
-	 cur -> _traversed = _globalTraversed;
-	 ++curLevel;
-	 for(size_t s = 0; s < cur -> _fanoutList.size(); ++s)
-			printFanout(cur, cur -> _fanoutList[s], curLevel, level);
-	 --curLevel;
-}
\ No newline at end of file
+		cur = fos(stack.back().first, stack.back().second++);
+	}
+}
@@ -0,0 +1,93 @@
+/****************************************************************************
+  FileName     [ cirHash.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define structural hash table of AND gates ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2012-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_HASH_H
+#define CIR_HASH_H
+
+#include <vector>
+#include "cirDef.h"
+
+using namespace std;
+
+// Maps an AND of two fanin literals (id * 2 + phase) to the id of the
+// gate that computes it; id 0 (const) marks an empty slot. Open
+// addressing with linear probing over a power-of-two table that is kept
+// at most half full; the literal pair is ordered before hashing so both
+// fanin orders meet in the same slot.
+class AigHash
+{
+public:
+   AigHash(size_t n = 0) { init(n); }
+   ~AigHash() {}
+
+   void init(size_t n) {
+      size_t cap = 16;
+      while (cap < n * 2) cap <<= 1;
+      _slots.assign(cap, Slot());
+      _size = 0;
+   }
+   size_t size() const { return _size; }
+
+   // Return the gate already stored for (a & b); otherwise store g for it
+   // and return 0
+   unsigned insert(unsigned a, unsigned b, unsigned g) {
+      unsigned long long k = key(a, b);
+      size_t mask = _slots.size() - 1;
+      for (size_t i = mix(k) & mask; ; i = (i + 1) & mask) {
+         if (!_slots[i]._gate) {
+            _slots[i]._key = k;
+            _slots[i]._gate = g;
+            if (++_size * 2 > _slots.size()) rehash();
+            return 0;
+         }
+         if (_slots[i]._key == k) return _slots[i]._gate;
+      }
+   }
+   unsigned find(unsigned a, unsigned b) const {
+      unsigned long long k = key(a, b);
+      size_t mask = _slots.size() - 1;
+      for (size_t i = mix(k) & mask; _slots[i]._gate; i = (i + 1) & mask)
+         if (_slots[i]._key == k) return _slots[i]._gate;
+      return 0;
+   }
+
+private:
+   struct Slot {
+      Slot() : _key(0), _gate(0) {}
+      unsigned long long  _key;
+      unsigned            _gate;
+   };
+   vector<Slot>   _slots;
+   size_t         _size;
+
+   static unsigned long long key(unsigned a, unsigned b) {
+      return a < b ? ((unsigned long long)a << 32) | b
+                   : ((unsigned long long)b << 32) | a;
+   }
+   // splitmix64 finalizer; every key bit affects the low bits used
+   static size_t mix(unsigned long long k) {
+      k ^= k >> 30; k *= 0xbf58476d1ce4e5b9ULL;
+      k ^= k >> 27; k *= 0x94d049bb133111ebULL;
+      k ^= k >> 31;
+      return (size_t)k;
+   }
+   void rehash() {
+      vector<Slot> old;
+      old.swap(_slots);
+      _slots.assign(old.size() * 2, Slot());
+      size_t mask = _slots.size() - 1;
+      for (size_t s = 0, n = old.size(); s < n; ++s) {
+         if (!old[s]._gate) continue;
+         size_t i = mix(old[s]._key) & mask;
+         while (_slots[i]._gate) i = (i + 1) & mask;
+         _slots[i] = old[s];
+      }
+   }
+};
+
+#endif // CIR_HASH_H
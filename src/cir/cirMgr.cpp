@@ -13,8 +13,14 @@
 #include <ctype.h>
 #include <cassert>
 #include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "cirMgr.h"
 #include "cirGate.h"
+#include "cirHash.h"
 #include "util.h"
 
 using namespace std;
@@ -54,10 +60,9 @@ enum CirParseError {
 /**************************************/
 static unsigned lineNo = 0;  // in printint, lineNo needs to ++
 static unsigned colNo  = 0;  // in printing, colNo needs to ++
-static char buf[1024];
 static string errMsg;
 static int errInt;
-static CirGate *errGate;
+static unsigned errGate;
 
 static bool
 parseError(CirParseError err)
@@ -122,7 +127,8 @@ parseError(CirParseError err)
       case REDEF_GATE:
          cerr << "[ERROR] Line " << lineNo+1 << ": Literal \"" << errInt
               << "\" is redefined, previously defined as "
-              << errGate->getTypeStr() << " in line " << errGate->getLineNo()
+              << cirMgr->getTypeStr(errGate) << " in line "
+              << cirMgr->getLineNo(errGate)
               << "!!" << endl;
          break;
       case REDEF_SYMBOLIC_NAME:
@@ -131,7 +137,7 @@ parseError(CirParseError err)
          break;
       case REDEF_CONST:
          cerr << "[ERROR] Line " << lineNo+1 << ", Col " << colNo+1
-              << ": Cannot redefine const (" << errInt << ")!!" << endl;
+              << ": Cannot redefine constant (" << errInt << ")!!" << endl;
          break;
       case NUM_TOO_SMALL:
          cerr << "[ERROR] Line " << lineNo+1 << ": " << errMsg
@@ -146,99 +152,425 @@ parseError(CirParseError err)
    return false;
 }
 
+// Scanner over the mmap-ed AAG file. Tokens end at a white space or at
+// the end of the file; colNo is kept at the start of the last token so
+// parseError() points at it.
+static const char *pCur = 0, *pEnd = 0, *pLine = 0;
+
+static inline bool
+atEnd() { return pCur == pEnd; }
+
+// a definition line without its new line is reported as missing
+static inline bool
+lineEnded() { return memchr(pCur, '\n', pEnd - pCur) != 0; }
+
+static bool
+readNum(unsigned &num, const char *name)
+{
+   colNo = pCur - pLine;
+   if (atEnd() || *pCur == '\n') {
+      errMsg = name;
+      return parseError(MISSING_NUM);
+   }
+   if (*pCur == ' ') return parseError(EXTRA_SPACE);
+   if (isspace(*pCur)) {
+      errInt = *pCur;
+      return parseError(ILLEGAL_WSPACE);
+   }
+   const char *s = pCur;
+   size_t v = 0;
+   bool ok = true;
+   for (; pCur != pEnd && !isspace(*pCur); ++pCur) {
+      if (*pCur < '0' || *pCur > '9' || v > INT_MAX) ok = false;
+      else v = v * 10 + (*pCur - '0');
+   }
+   if (!ok || v > INT_MAX) {
+      errMsg = string(name) + "(" + string(s, pCur) + ")";
+      return parseError(ILLEGAL_NUM);
+   }
+   num = v;
+   return true;
+}
+
+// a single space before the token "next"; a line ending early reports
+// the missing token if "next" is given
+static bool
+readSpace(const char *next = 0)
+{
+   colNo = pCur - pLine;
+   if (!atEnd() && *pCur == ' ') { ++pCur; return true; }
+   if (next && (atEnd() || *pCur == '\n')) {
+      errMsg = next;
+      return parseError(MISSING_NUM);
+   }
+   return parseError(MISSING_SPACE);
+}
+
+static bool
+readNewline()
+{
+   colNo = pCur - pLine;
+   if (atEnd() || *pCur != '\n') return parseError(MISSING_NEWLINE);
+   pLine = ++pCur;
+   ++lineNo;
+   return true;
+}
+
+// 7-bit groups, least significant first; the high bit marks more groups
+static bool
+readDelta(unsigned &d)
+{
+   d = 0;
+   for (unsigned shift = 0; shift < 32; shift += 7) {
+      if (atEnd()) return false;
+      unsigned char c = *pCur++;
+      d |= (unsigned)(c & 0x7f) << shift;
+      if (!(c & 0x80)) return true;
+   }
+   return false;
+}
+
+static void
+writeDelta(ostream& outfile, unsigned d)
+{
+   while (d & ~0x7fU) {
+      outfile.put((char)((d & 0x7f) | 0x80));
+      d >>= 7;
+   }
+   outfile.put((char)d);
+}
+
 /**************************************************************/
 /*   class CirMgr member functions for circuit construction   */
 /**************************************************************/
+// The file is mapped into memory and scanned in place. Definitions are
+// read first; fanouts are counted so that every fanout list is allocated
+// once before the gates are connected. With "doStrash" the AND gates are
+// hash-consed on the way (see strashDefs()).
 bool
-CirMgr::readCircuit(const string& fileName)
+CirMgr::readCircuit(const string& fileName, bool doStrash)
 {
-   ifstream inFile(fileName.c_str(), ios::in);
-   if(!inFile){
+   int fd = open(fileName.c_str(), O_RDONLY);
+   struct stat st;
+   if (fd < 0 || fstat(fd, &st) < 0) {
+      if (fd >= 0) close(fd);
       cerr << "Cannot open design \"" << fileName << "\"!!\n";
       return false;
    }
+   size_t size = st.st_size;
+   void *map = size ? mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0) : 0;
+   close(fd);
+   if (map == MAP_FAILED) {
+      cerr << "Cannot open design \"" << fileName << "\"!!\n";
+      return false;
+   }
+#ifdef MADV_SEQUENTIAL
+   if (size) madvise(map, size, MADV_SEQUENTIAL);
+#endif
+
+   pCur = pLine = (const char*)map;
+   pEnd = pCur + size;
+   lineNo = colNo = 0;
+   bool ok = parseAag(doStrash);
+   if (size) munmap(map, size);
+   pCur = pEnd = pLine = 0;
+   if (!ok)
+      return false;
+
+	updateOpen();
+	updateDFS();
 
-   string inStr;
-   unsigned inNum;
+   return true;
+}
 
+bool CirMgr::parseAag(bool doStrash){
    // header
-   inFile >> inStr; // aag
-   inFile >> _maxVarId;
-   inFile >> _nPI;
-   inFile >> inNum; // L
-   inFile >> _nPO;
-   inFile >> _nAIG;
-
-   _gates.resize(_maxVarId + 1 +_nPO);
-   _gates[0] = new CirConstGate();
-   for(size_t s = 1; s < _gates.size(); ++s)
-      _gates[s] = 0;
-   
-	// inputs
-	// problem: not sure about the order of fanins!!!!!
-	unsigned line = 1;
-   for(unsigned i = 0; i < _nPI; ++i){
-      inFile >> inNum;
-      _PIList.push_back(inNum / 2);
-      _gates[inNum / 2] = new CirPIGate(inNum / 2, ++line);
+   colNo = 0;
+   if (atEnd()) {
+      errMsg = "aag";
+      return parseError(MISSING_IDENTIFIER);
+   }
+   if (*pCur == ' ') return parseError(EXTRA_SPACE);
+   if (isspace(*pCur)) {
+      errInt = *pCur;
+      return parseError(ILLEGAL_WSPACE);
+   }
+   const char *s = pCur;
+   while (!atEnd() && !isspace(*pCur)) ++pCur;
+   string ident(s, pCur);
+   if (ident != "aag" && ident != "aig") {
+      errMsg = ident;
+      return parseError(ILLEGAL_IDENTIFIER);
+   }
+   bool binary = (ident == "aig");
+   unsigned nLatch;
+   if (!readSpace("number of variables") || !readNum(_maxVarId, "number of variables") ||
+       !readSpace("number of PIs") || !readNum(_nPI, "number of PIs") ||
+       !readSpace("number of latches") || !readNum(nLatch, "number of latches") ||
+       !readSpace("number of POs") || !readNum(_nPO, "number of POs") ||
+       !readSpace("number of AIGs") || !readNum(_nAIG, "number of AIGs"))
+      return false;
+   if ((size_t)_maxVarId < (size_t)_nPI + nLatch + _nAIG) {
+      errMsg = "Number of variables";
+      errInt = _maxVarId;
+      return parseError(NUM_TOO_SMALL);
+   }
+   if (nLatch != 0) {
+      errMsg = "latches";
+      return parseError(ILLEGAL_NUM);
    }
+   // binary AIGER numbers PIs and then AIGs from 1 without gaps
+   if (binary && _maxVarId != _nPI + _nAIG) {
+      errMsg = "Number of variables";
+      errInt = _maxVarId;
+      return parseError(NUM_TOO_BIG);
+   }
+   // a header cut off by the end of the file still counts as a line
+   if (atEnd()) ++lineNo;
+   else if (!readNewline())
+      return false;
 
-	// outputs
-	for(unsigned i = 0; i < _nPO; ++i){
-      inFile >> inNum;
-      _gates[_maxVarId + i + 1] = new CirPOGate(_maxVarId + i + 1, ++line);
-      if(_gates[inNum / 2] == 0)
-         _gates[inNum / 2] = new CirAigGate(inNum / 2);
-      
-      // connect PO and its fanin
-      _gates[_maxVarId + i + 1]->_faninList.push_back(CirGateV(_gates[inNum / 2], inNum % 2));
-      _gates[inNum / 2]->_fanoutList.push_back(_gates[_maxVarId + i + 1]);
+   initStore(_maxVarId + 1 + _nPO, _nPO + 2 * _nAIG);
+   _PIList.reserve(_nPI);
+
+	// inputs; implicit in binary AIGER, where they get the lines they
+	// would have in the ASCII file
+   unsigned lit;
+   for (unsigned i = 0; binary && i < _nPI; ++i) {
+      _PIList.push_back(i + 1);
+      newGate(i + 1, PI_GATE, i + 2);
+   }
+   for (unsigned i = 0; !binary && i < _nPI; ++i) {
+      if (!lineEnded()) {
+         errMsg = "PI";
+         return parseError(MISSING_DEF);
+      }
+      if (!readNum(lit, "PI literal ID"))
+         return false;
+      errInt = lit;
+      if (lit / 2 == 0) return parseError(REDEF_CONST);
+      if (lit % 2) {
+         errMsg = "PI";
+         return parseError(CANNOT_INVERTED);
+      }
+      if (lit / 2 > _maxVarId) return parseError(MAX_LIT_ID);
+      if (hasGate(lit / 2)) {
+         errGate = lit / 2;
+         return parseError(REDEF_GATE);
+      }
+      _PIList.push_back(lit / 2);
+      newGate(lit / 2, PI_GATE, lineNo + 1);
+      if (!readNewline())
+         return false;
    }
 
-	// AND gates
-	CirGate *cur;
-	unsigned fi[2];
-   for(unsigned i = 0; i < _nAIG; ++i){
-      inFile >> inNum;
-      if(_gates[inNum / 2] == 0)
-         _gates[inNum / 2] = new CirAigGate(inNum / 2, ++line);
-      else
-         _gates[inNum / 2] -> _line = ++line;
-      
-      cur = _gates[inNum / 2];
-      for(unsigned j = 0; j < 2; ++j){
-         inFile >> inNum;
-         if(_gates[inNum / 2] == 0)
-            _gates[inNum / 2] = new CirAigGate(inNum / 2);
-         
-         // connect two fanins to the gate
-         cur->_faninList.push_back(CirGateV(_gates[inNum / 2], inNum % 2));
-         _gates[inNum / 2]->_fanoutList.push_back(cur);
+	// outputs
+   IdList poLits(_nPO);
+   for (unsigned i = 0; i < _nPO; ++i) {
+      if (!lineEnded()) {
+         errMsg = "PO";
+         return parseError(MISSING_DEF);
       }
+      if (!readNum(poLits[i], "PO literal ID"))
+         return false;
+      errInt = poLits[i];
+      if (poLits[i] / 2 > _maxVarId) return parseError(MAX_LIT_ID);
+      newGate(_maxVarId + i + 1, PO_GATE, binary ? _nPI + i + 2 : lineNo + 1);
+      if (!readNewline())
+         return false;
    }
 
-	// symbols
-   while(inFile >> inStr && inStr != "c"){
-      if(inStr[0] == 'i'){
-         inNum = stoi(inStr.substr(1, inStr.size() - 1));
-         inFile.get();
-         getline(inFile, inStr);
-         _gates[_PIList[inNum]]->_name = inStr;
+	// AND gates: output and two input literals each
+   IdList aigLits(_nAIG * 3);
+   for (unsigned i = 0; binary && i < _nAIG; ++i) {
+      // "lhs rhs0 rhs1" with lhs > rhs0 >= rhs1, stored as two deltas
+      unsigned *l = &aigLits[i * 3], d0, d1;
+      l[0] = (_nPI + i + 1) * 2;
+      if (!readDelta(d0) || !readDelta(d1)) {
+         errMsg = "AIG";
+         return parseError(MISSING_DEF);
       }
-      else{ // inStr[0] == 'o'
-         inNum = _maxVarId + 1 + stoi(inStr.substr(1, inStr.size() - 1));
-         inFile.get();
-         getline(inFile, inStr);
-         _gates[inNum]->_name = inStr;
+      if (d0 == 0 || d0 > l[0] || d1 > l[0] - d0) {
+         errMsg = "AIG input literal delta";
+         return parseError(ILLEGAL_NUM);
       }
+      l[1] = l[0] - d0;
+      l[2] = l[1] - d1;
+      newGate(l[0] / 2, AIG_GATE, _nPI + _nPO + i + 2);
+   }
+   if (binary)
+      pLine = pCur;
+   for (unsigned i = 0; !binary && i < _nAIG; ++i) {
+      if (!lineEnded()) {
+         errMsg = "AIG";
+         return parseError(MISSING_DEF);
+      }
+      unsigned *l = &aigLits[i * 3];
+      if (!readNum(l[0], "AIG gate literal ID"))
+         return false;
+      errInt = l[0];
+      if (l[0] / 2 == 0) return parseError(REDEF_CONST);
+      if (l[0] % 2) {
+         errMsg = "AIG gate";
+         return parseError(CANNOT_INVERTED);
+      }
+      if (l[0] / 2 > _maxVarId) return parseError(MAX_LIT_ID);
+      if (hasGate(l[0] / 2)) {
+         errGate = l[0] / 2;
+         return parseError(REDEF_GATE);
+      }
+      newGate(l[0] / 2, AIG_GATE, lineNo + 1);
+      for (unsigned j = 1; j < 3; ++j) {
+         if (!readSpace() || !readNum(l[j], "AIG input literal ID"))
+            return false;
+         errInt = l[j];
+         if (l[j] / 2 > _maxVarId) return parseError(MAX_LIT_ID);
+      }
+      if (!readNewline())
+         return false;
    }
 
-	updateOpen();
-	updateDFS();
+   if (doStrash)
+      strashDefs(aigLits, poLits);
+
+   // undefined fanins become AIGs without a line; fanout lists are sized
+   // before connecting, POs first and then the AIGs in file order
+   IdList nFanout(_maxVarId + 1, 0);
+   for (unsigned i = 0; i < _nPO; ++i)
+      ++nFanout[poLits[i] / 2];
+   for (unsigned i = 0; i < _nAIG; ++i) {
+      ++nFanout[aigLits[i * 3 + 1] / 2];
+      ++nFanout[aigLits[i * 3 + 2] / 2];
+   }
+   for (unsigned id = 0; id <= _maxVarId; ++id) {
+      if (!nFanout[id])
+         continue;
+      if (!hasGate(id)) {
+         newGate(id, AIG_GATE);
+         _gateFlag[id] = GATE_UNDEF;
+      }
+      _fanouts.reserve(id, nFanout[id]);
+   }
+   for (unsigned i = 0; i < _nPO; ++i)
+      connect(_maxVarId + i + 1, 0, poLits[i]);
+   for (unsigned i = 0; i < _nAIG; ++i) {
+      connect(aigLits[i * 3] / 2, 0, aigLits[i * 3 + 1]);
+      connect(aigLits[i * 3] / 2, 1, aigLits[i * 3 + 2]);
+   }
 
+	// symbols, until the end of file or the comment section
+   while (!atEnd()) {
+      colNo = 0;
+      char type = *pCur;
+      if (type == 'c') {
+         ++pCur;
+         return atEnd() || readNewline();
+      }
+      if (type == ' ') return parseError(EXTRA_SPACE);
+      if (type != 'i' && type != 'o') {
+         if (isspace(type)) {
+            errInt = type;
+            return parseError(ILLEGAL_WSPACE);
+         }
+         errMsg = type;
+         return parseError(ILLEGAL_SYMBOL_TYPE);
+      }
+      ++pCur;
+      colNo = 1;
+      if (!atEnd() && *pCur == ' ') return parseError(EXTRA_SPACE);
+      unsigned idx;
+      if (!readNum(idx, "symbol index"))
+         return false;
+      unsigned nMax = (type == 'i' ? _nPI : _nPO);
+      if (idx >= nMax) {
+         errMsg = (type == 'i' ? "PI index" : "PO index");
+         errInt = idx;
+         return parseError(NUM_TOO_BIG);
+      }
+      if (atEnd() || *pCur != ' ' || pCur + 1 == pEnd || pCur[1] == '\n') {
+         errMsg = "symbolic name";
+         return parseError(MISSING_IDENTIFIER);
+      }
+      s = ++pCur;
+      for (; !atEnd() && *pCur != '\n'; ++pCur) {
+         if (!isprint(*pCur)) {
+            colNo = pCur - pLine;
+            errInt = *pCur;
+            return parseError(ILLEGAL_SYMBOL_NAME);
+         }
+      }
+      unsigned g = (type == 'i' ? _PIList[idx] : _maxVarId + 1 + idx);
+      if (_gateName.count(g)) {
+         errMsg = type;
+         errInt = idx;
+         return parseError(REDEF_SYMBOLIC_NAME);
+      }
+      _gateName[g].assign(s, pCur);
+      if (!atEnd() && !readNewline())
+         return false;
+   }
    return true;
 }
 
+// Build the parsed AND definitions in topological order through
+// createAnd(). A gate that folds into a constant, one of its fanins or an
+// earlier gate is removed before it is ever connected; the definitions
+// left in "aigLits" and the literals in "poLits" refer to what the
+// folded gates became.
+void CirMgr::strashDefs(IdList &aigLits, IdList &poLits){
+   IdList defOf(_maxVarId + 1, 0), litOf(_maxVarId + 1);
+   for (unsigned v = 0; v <= _maxVarId; ++v)
+      litOf[v] = v * 2;
+   for (unsigned i = 0; i < _nAIG; ++i)
+      defOf[aigLits[i * 3] / 2] = i + 1;
+
+   AigHash hash(_nAIG);
+   vector<char> state(_maxVarId + 1, 0); // 1: on the stack, 2: built
+   IdList stack;
+   for (unsigned i = 0; i < _nAIG; ++i) {
+      unsigned root = aigLits[i * 3] / 2;
+      if (state[root])
+         continue;
+      state[root] = 1;
+      stack.push_back(root);
+      while (!stack.empty()) {
+         unsigned v = stack.back(), *l = &aigLits[(defOf[v] - 1) * 3];
+         unsigned j = 1;
+         for (; j < 3; ++j) {
+            unsigned f = l[j] / 2;
+            if (defOf[f] && !state[f]) {
+               state[f] = 1;
+               stack.push_back(f);
+               break;
+            }
+         }
+         if (j < 3)
+            continue;
+         stack.pop_back();
+         state[v] = 2;
+         litOf[v] = createAnd(v, litOf[l[1] / 2] ^ (l[1] & 1),
+                              litOf[l[2] / 2] ^ (l[2] & 1), hash);
+      }
+   }
+
+   unsigned k = 0;
+   for (unsigned i = 0; i < _nAIG; ++i) {
+      unsigned v = aigLits[i * 3] / 2;
+      if (litOf[v] != v * 2) {
+         removeGate(v);
+         continue;
+      }
+      aigLits[k * 3] = v * 2;
+      aigLits[k * 3 + 1] = _fanin[0][v];
+      aigLits[k * 3 + 2] = _fanin[1][v];
+      ++k;
+   }
+   _nAIG = k;
+   aigLits.resize(k * 3);
+   for (unsigned i = 0; i < _nPO; ++i)
+      poLits[i] = litOf[poLits[i] / 2] ^ (poLits[i] & 1);
+}
+
 /**********************************************************/
 /*   class CirMgr member functions for circuit printing   */
 /**********************************************************/
@@ -266,10 +598,12 @@ CirMgr::printSummary() const
 void
 CirMgr::printNetlist() const
 {
+   IdList buf;
+   const IdList &dfs = dfsOrder(buf);
    cout << endl;
-   for (unsigned i = 0, n = _dfsList.size(); i < n; ++i) {
+   for (unsigned i = 0, n = dfs.size(); i < n; ++i) {
       cout << "[" << i << "] ";
-      _dfsList[i]->printGate();
+      printGate(dfs[i]);
    }
 }
 
@@ -296,9 +630,10 @@ CirMgr::printFloatGates() const
 {
 	if(_undefList.size()){
 		cout << "Gates with floating fanin(s):";
+		const FanoutIndex &fos = fanoutIndex();
 		for(unsigned i = 0, n = _undefList.size(); i < n; ++i){
-			for(size_t s = 0; s < _undefList[i]->_fanoutList.size(); ++s)
-         	cout << ' ' << _undefList[i]->_fanoutList[s]->_id; // what if printed already?
+			for(unsigned s = 0, n = fos.size(_undefList[i]); s < n; ++s)
+         	cout << ' ' << fos(_undefList[i], s); // what if printed already?
 		}
 		cout << endl;
 	}
@@ -306,7 +641,7 @@ CirMgr::printFloatGates() const
 	if(_unusedList.size()){
 		cout << "Gates defined but not used  :";
 		for(unsigned i = 0, n = _unusedList.size(); i < n; ++i)
-			cout << ' ' << _unusedList[i]->_id;
+			cout << ' ' << _unusedList[i];
 		cout << endl;
 	}
 }
@@ -314,75 +649,138 @@ CirMgr::printFloatGates() const
 void
 CirMgr::printFECPairs() const
 {	
-	for(unsigned i = 0, n = _fecGrps.size(); i < n; ++i){
+	for(unsigned i = 0, n = numFecGrps(); i < n; ++i){
 		cout << '[' << i << ']';
-		for(unsigned j = 0, m = _fecGrps[i].size(); j < m; ++j){
+		unsigned first = _fecLits[_fecBegin[i]];
+		for(unsigned j = _fecBegin[i]; j < _fecBegin[i + 1]; ++j){
 			cout << ' ';
-			if(_fecGrps[i][j]->_inv != _fecGrps[i][0]->_inv)
+			if((_fecLits[j] ^ first) & 1)
 				cout << '!';
-			cout << _fecGrps[i][j]->_id;
+			cout << (_fecLits[j] >> 1);
 		}
 		cout << endl;
 	}
 }
 
+// Print the other members of the FEC group of gate "gid"
+void
+CirMgr::printGateFECs(unsigned gid) const
+{
+	for(unsigned i = 0, n = numFecGrps(); i < n; ++i){
+		for(unsigned j = _fecBegin[i]; j < _fecBegin[i + 1]; ++j){
+			if((_fecLits[j] >> 1) != gid)
+				continue;
+			for(unsigned k = _fecBegin[i]; k < _fecBegin[i + 1]; ++k){
+				if(k == j)
+					continue;
+				cout << ' ';
+				if((_fecLits[k] ^ _fecLits[j]) & 1)
+					cout << '!';
+				cout << (_fecLits[k] >> 1);
+			}
+			return;
+		}
+	}
+}
+
 void
 CirMgr::writeAag(ostream& outfile) const
 {
-	// header line
-   outfile << "aag " << _maxVarId << ' ' << _nPI << " 0 " << _nPO << ' ';
-   // buid a GateList with only aig gates in DFS order
-	GateList aigList;
-	for (unsigned i = 0, n = _dfsList.size(); i < n; ++i){
-		if(_dfsList[i]->getType() == AIG_GATE)
-			aigList.push_back(_dfsList[i]);
+   // buid a list with only aig gates in DFS order
+	IdList aigList, buf;
+	const IdList &dfs = dfsOrder(buf);
+	unsigned maxVarId = _maxVarId; // gates added by optimizations lie past the POs
+	for (unsigned i = 0, n = dfs.size(); i < n; ++i){
+		if(_gateType[dfs[i]] == AIG_GATE){
+			aigList.push_back(dfs[i]);
+			if(dfs[i] > maxVarId)
+				maxVarId = dfs[i];
+		}
 	}
-	outfile << aigList.size() << endl;
+	// header line
+   outfile << "aag " << maxVarId << ' ' << _nPI << " 0 " << _nPO << ' '
+           << aigList.size() << endl;
 
 	// inputs
 	for(unsigned i = 0; i < _nPI; ++i)
       outfile << _PIList[i] * 2 << endl;
 	
 	// outputs
-	for(unsigned i = 0; i < _nPO; ++i){
-      if(_gates[_maxVarId + 1 + i]->_faninList[0].isInv())
-         outfile << _gates[_maxVarId + 1 + i]->_faninList[0].gate()->_id * 2 + 1;
-      else
-         outfile << _gates[_maxVarId + 1 + i]->_faninList[0].gate()->_id * 2;
-      outfile << endl;
-   }
+	for(unsigned i = 0; i < _nPO; ++i)
+      outfile << _fanin[0][_maxVarId + 1 + i] << endl;
 
 	// AND gates
 	for(unsigned i = 0, n = aigList.size(); i < n; ++i){
-		outfile << aigList[i]->_id * 2;
+		outfile << aigList[i] * 2;
+		for(int j = 0; j < 2; ++j)
+         outfile << ' ' << _fanin[j][aigList[i]];
+		outfile << endl;
+	}
+
+	writeSymbols(outfile);
+   outfile << "c\nAAG output by Chung-Yang (Ric) Huang\n";
+}
+
+// Binary AIGER renumbers the gates: PIs get 1..I in _PIList order and the
+// AIGs in DFS order follow. Undefined fanins are written as const 0.
+void
+CirMgr::writeAig(ostream& outfile) const
+{
+	IdList newId(_gateType.size(), 0);
+	for(unsigned i = 0; i < _nPI; ++i)
+		newId[_PIList[i]] = i + 1;
+	IdList aigList, buf;
+	const IdList &dfs = dfsOrder(buf);
+	for(unsigned i = 0, n = dfs.size(); i < n; ++i){
+		if(_gateType[dfs[i]] == AIG_GATE){
+			aigList.push_back(dfs[i]);
+			newId[dfs[i]] = _nPI + aigList.size();
+		}
+	}
+	outfile << "aig " << _nPI + aigList.size() << ' ' << _nPI << " 0 " << _nPO
+	        << ' ' << aigList.size() << endl;
+
+	// outputs
+	for(unsigned i = 0; i < _nPO; ++i){
+		unsigned lit = _fanin[0][_maxVarId + 1 + i];
+		outfile << makeLit(newId[litId(lit)], litInv(lit)) << endl;
+	}
+
+	// AND gates as deltas
+	for(unsigned i = 0, n = aigList.size(); i < n; ++i){
+		unsigned lhs = newId[aigList[i]] * 2, rhs[2];
 		for(int j = 0; j < 2; ++j){
-			if(aigList[i]->_faninList[j].isInv())
-            outfile << ' ' << aigList[i]->_faninList[j].gate()->_id * 2 + 1;
-         else
-            outfile << ' ' << aigList[i]->_faninList[j].gate()->_id * 2;
+			unsigned lit = _fanin[j][aigList[i]];
+			rhs[j] = makeLit(newId[litId(lit)], litInv(lit));
 		}
-		outfile << endl;
+		if(rhs[0] < rhs[1])
+			swap(rhs[0], rhs[1]);
+		writeDelta(outfile, lhs - rhs[0]);
+		writeDelta(outfile, rhs[0] - rhs[1]);
 	}
 
-	// symbols
+	writeSymbols(outfile);
+   outfile << "c\nAIG output by Chung-Yang (Ric) Huang\n";
+}
+
+void
+CirMgr::writeSymbols(ostream& outfile) const
+{
+	map<unsigned, string>::const_iterator name;
 	for(unsigned i = 0; i < _nPI; ++i){
-      if(_gates[_PIList[i]]->_name.size())
-         outfile << 'i' << i << ' ' << _gates[_PIList[i]]->_name << endl;
+      if((name = _gateName.find(_PIList[i])) != _gateName.end())
+         outfile << 'i' << i << ' ' << name->second << endl;
    }
 	for(unsigned i = 0; i < _nPO; ++i){
-      if(_gates[_maxVarId + 1 + i]->_name.size())
-         outfile << 'o' << i << ' ' << _gates[_maxVarId + 1 + i]->_name << endl;
+      if((name = _gateName.find(_maxVarId + 1 + i)) != _gateName.end())
+         outfile << 'o' << i << ' ' << name->second << endl;
    }
-   
-   // comments
-   outfile << "c\nAAG output by Yu-An Shih\n";
 }
 
 void
-CirMgr::writeGate(ostream& outfile, CirGate *g) const
+CirMgr::writeGate(ostream& outfile, unsigned gid) const
 {
-	GateList gDfsList;
-	//buildGdfs(g, gDfsList);
+	//buildGdfs(gid, gDfsList);
 }
 
 // supporting functions
@@ -390,34 +788,162 @@ void CirMgr::updateOpen(){
    _undefList.clear();
 	_unusedList.clear();
 	
-	for(unsigned i = 1; i <= _maxVarId; ++i){
-      if(_gates[i] == 0)
+	const FanoutIndex &fos = fanoutIndex();
+	for(unsigned i = 1, n = _gateType.size(); i < n; ++i){
+      if(!hasGate(i) || _gateType[i] == PO_GATE)
          continue;
-      if(_gates[i]->getType() == AIG_GATE && _gates[i]->_faninList.empty()){
-			_gates[i]->_undefined = true;
-			_undefList.push_back(_gates[i]);
-		}
-      if(_gates[i]->_fanoutList.empty()){ // including PIs?
-			_gates[i]->_unused = true;
-			_unusedList.push_back(_gates[i]);
+      if(isUndef(i))
+			_undefList.push_back(i);
+      // merges may give an unused gate new fanouts; refresh the flag
+      if(fos.empty(i)){ // including PIs?
+			_gateFlag[i] |= GATE_UNUSED;
+			_unusedList.push_back(i);
 		}
+		else
+			_gateFlag[i] &= ~GATE_UNUSED;
    }
 }
 
+// Rebuild _dfsList as the DFS order from the POs, with the cone
+// references and levels that keep it valid through later merges
 void CirMgr::updateDFS(){
-	_dfsList.clear();
+	collectDFS(_dfsList);
+	_dfsRef.assign(_gateType.size(), 0);
+	_dfsPos.resize(_gateType.size());
+	for(unsigned i = 0, n = _gateFlag.size(); i < n; ++i)
+		_gateFlag[i] &= ~GATE_INDFS;
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i];
+		_dfsPos[g] = i;
+		_gateFlag[g] |= GATE_INDFS;
+		for(unsigned j = 0, m = faninNum(g); j < m; ++j)
+			++_dfsRef[litId(_fanin[j][g])];
+	}
+	_dfsExact = true;
+	levelize();
+	compileSim();
+}
 
-	++CirGate::_globalTraversed;
+void CirMgr::collectDFS(IdList &order) const{
+	order.clear();
+	newMark();
+	IdList stack;
 	for(unsigned i = 0; i < _nPO; ++i)
-      dfsTraverse(_gates[_maxVarId + 1 + i]);
+      dfsTraverse(_maxVarId + 1 + i, stack, order);
 }
 
-void CirMgr::dfsTraverse(CirGate *const &g){
-	if(g->_undefined || g->_traversed == CirGate::_globalTraversed)
+// Append the unmarked fanin cone of "root" to "order" in post-order.
+// A gate stays on the explicit stack until its fanins are done, so deep
+// circuits never recurse.
+void CirMgr::dfsTraverse(unsigned root, IdList &stack, IdList &order) const{
+	if(isUndef(root) || isMarked(root))
 		return ;
-	for(size_t s = 0; s < g->_faninList.size(); ++s)
-      dfsTraverse(g->_faninList[s].gate());
-	
-	_dfsList.push_back(g);
-	g->_traversed = CirGate::_globalTraversed;
+	setMark(root);
+	stack.push_back(root);
+	while(!stack.empty()){
+		unsigned g = stack.back(), n = faninNum(g), i = 0;
+		for(; i < n; ++i){
+			unsigned f = litId(_fanin[i][g]);
+			if(!isUndef(f) && !isMarked(f)){
+				setMark(f);
+				stack.push_back(f);
+				break;
+			}
+		}
+		if(i < n)
+			continue;
+		stack.pop_back();
+		order.push_back(g);
+	}
+}
+
+// The DFS order from the POs; _dfsList itself unless merges have
+// reordered the cone, otherwise a fresh traversal into "buf"
+const IdList& CirMgr::dfsOrder(IdList &buf) const{
+	if(_dfsExact)
+		return _dfsList;
+	collectDFS(buf);
+	return buf;
+}
+
+void CirMgr::levelize(){
+	_level.assign(_gateType.size(), 0);
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i];
+		for(unsigned j = 0, m = faninNum(g); j < m; ++j){
+			unsigned l = _level[litId(_fanin[j][g])];
+			if(l > _level[g])
+				_level[g] = l;
+		}
+		if(_gateType[g] == AIG_GATE)
+			++_level[g];
+	}
+}
+
+// The fanouts of "g" are about to move to "r": the cone references go
+// along, and "g" leaves the cone. They are counted by _dfsRef, which also
+// covers the gates merged into "g" before.
+void CirMgr::dfsReplace(unsigned g, unsigned r){
+	dfsRef(r, _dfsRef[g]);
+	dfsDeref(g);
+}
+
+// "n" more fanin slots in the cone point at "root". A gate that left the
+// cone since the last compaction comes back with its fanins; its
+// tombstone still holds a valid position.
+void CirMgr::dfsRef(unsigned root, unsigned n){
+	_dfsRef[root] += n;
+	if(n == 0 || inDFS(root) || isUndef(root))
+		return ;
+	_gateFlag[root] |= GATE_INDFS;
+	IdList stack(1, root);
+	while(!stack.empty()){
+		unsigned g = stack.back();
+		stack.pop_back();
+		for(unsigned i = 0, m = faninNum(g); i < m; ++i){
+			unsigned f = litId(findRepr(_fanin[i][g]));
+			if(_dfsRef[f]++ == 0 && !isUndef(f)){
+				_gateFlag[f] |= GATE_INDFS;
+				stack.push_back(f);
+			}
+		}
+	}
+}
+
+// Take "root" out of the cone; fanins left without fanouts in the cone
+// follow it. Their entries in _dfsList become tombstones.
+void CirMgr::dfsDeref(unsigned root){
+	if(!inDFS(root))
+		return ;
+	_gateFlag[root] &= ~GATE_INDFS;
+	IdList stack(1, root);
+	while(!stack.empty()){
+		unsigned g = stack.back();
+		stack.pop_back();
+		for(unsigned i = 0, m = faninNum(g); i < m; ++i){
+			unsigned f = litId(findRepr(_fanin[i][g]));
+			if(--_dfsRef[f] == 0 && inDFS(f)){
+				_gateFlag[f] &= ~GATE_INDFS;
+				stack.push_back(f);
+			}
+		}
+	}
+}
+
+// Drop the tombstones in one pass; the rest is still in topological
+// order. Return false if there were none.
+bool CirMgr::compactDFS(){
+	unsigned k = 0;
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		if(inDFS(_dfsList[i])){
+			_dfsPos[_dfsList[i]] = k;
+			_dfsList[k++] = _dfsList[i];
+		}
+	}
+	if(k == _dfsList.size())
+		return false;
+	_dfsList.resize(k);
+	levelize();
+	compileSim();
+	return true;
 }
\ No newline at end of file
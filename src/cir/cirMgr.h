@@ -11,6 +11,8 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <queue>
 #include <fstream>
 #include <iostream>
 
@@ -19,40 +21,58 @@ using namespace std;
 // TODO: Feel free to define your own classes, variables, or functions.
 
 #include "cirDef.h"
+#include "cirGate.h"
+#include "cirArena.h"
+#include "sat.h"
+#include "rnGen.h"
 
 extern CirMgr *cirMgr;
 
 class CirMgr
 {
 public:
-   CirMgr() {}
+   CirMgr() : _markStamp(0), _dfsExact(false), _optAll(true), _fecFresh(false) {}
    ~CirMgr() {} 
 
    // Access functions
-   // return '0' if "gid" corresponds to an undefined gate.
-   CirGate* getGate(unsigned gid) const {
-      // will print out UNDEF for _undefined gates
-		if(gid < _gates.size())
-			return _gates[gid];
-      return 0;
+   // return false if "gid" is out of range or its gate has been removed;
+   // undefined gates are reported as UNDEF
+   bool hasGate(unsigned gid) const {
+      return gid < _gateType.size() && _gateType[gid] != TOT_GATE;
    }
+   GateType getType(unsigned gid) const { return (GateType)_gateType[gid]; }
+   bool isAig(unsigned gid) const { return _gateType[gid] == AIG_GATE; }
+   string getTypeStr(unsigned gid) const;
+   unsigned getLineNo(unsigned gid) const { return _gateLine[gid]; }
+   // AIGs on the longest path from a PI; 0 for gates out of the DFS cone
+   unsigned getLevel(unsigned gid) const { return _level[gid]; }
+	// SIM_WORDS words of simulation value of gate "gid";
+	// gates outside the DFS cone read as const 0
+	const size_t* getSimVal(unsigned gid) const {
+		return &_simVals[_simSlot[gid] * SIM_WORDS];
+	}
 
    // Member functions about circuit construction
-   bool readCircuit(const string&);
+   bool readCircuit(const string&, bool doStrash = false);
 
    // Member functions about circuit optimization
-   void sweep();
+   void sweep(bool verbose = true);
    void optimize();
+   void compact();
+   void rewrite();
+   void balance();
 
    // Member functions about simulation
-   void randomSim();
+   void randomSim(unsigned nThread = 1);
    void fileSim(ifstream&);
    void setSimLog(ofstream *logFile) { _simLog = logFile; }
+   void setSimSeed(unsigned seed) { _simGen.seed(seed); }
 
    // Member functions about fraig
    void strash();
    void printFEC() const;
    void fraig();
+   void resub();
 
    // Member functions about circuit reporting
    void printSummary() const;
@@ -61,13 +81,20 @@ public:
    void printPOs() const;
    void printFloatGates() const;
    void printFECPairs() const;
+   void printGateFECs(unsigned gid) const;
    void writeAag(ostream&) const;
-   void writeGate(ostream&, CirGate*) const;
+   void writeAig(ostream&) const;
+   void writeGate(ostream&, unsigned) const;
 
-	vector<FecGroup> _fecGrps;
+   // Member functions about gate reporting
+   void printGate(unsigned gid) const;
+   void reportGate(unsigned gid) const;
+   void reportFanin(unsigned gid, int level) const;
+   void reportFanout(unsigned gid, int level) const;
 
 private:
    ofstream           *_simLog;
+   RandomWordGen       _simGen;
    
    // AIGER
    unsigned _maxVarId;
@@ -75,30 +102,138 @@ private:
    unsigned _nPO;
    unsigned _nAIG;
 
-   GateList _gates; // for finding gates through Id
+   // AIG store, indexed by gate id
+   vector<unsigned char> _gateType;  // GateType
+   vector<unsigned char> _gateFlag;  // GATE_UNDEF | GATE_UNUSED
+   IdList _fanin[2];                 // fanin literals; a PO uses _fanin[0]
+   IdList _gateLine;
+   IdList _level;                    // logic level, see levelize()
+   FanoutArena _fanouts;             // fanout ids in connection order
+   IdList _repr;                     // pending merges, see findRepr()
+   IdList _mergeLog;                 // merged gates in merge order
+   mutable FanoutIndex _foIndex;     // CSR copy for read-only passes
+   map<unsigned, string> _gateName;  // symbols of PIs and POs
+   mutable IdList _mark;             // traversal marks, see newMark()
+   mutable unsigned _markStamp;
+
    IdList _PIList;
-	GateList _dfsList;
-	GateList _unusedList;
-	GateList _undefList;
+	// gates in the fanin cone of the POs in topological order. Merges
+	// leave tombstones (gates without GATE_INDFS) until compactDFS();
+	// _dfsRef counts the fanin slots of cone gates pointing at each gate.
+	// _dfsExact holds while the order is the one updateDFS() would give.
+	IdList _dfsList;
+	IdList _dfsRef;
+	IdList _dfsPos;          // position in _dfsList at the last compaction
+	bool _dfsExact;
+	// gates to look at in the next optimize(); every AIG if _optAll
+	IdList _optDirty;
+	bool _optAll;
+	IdList _unusedList;
+	IdList _undefList;
+	// for fraig; SAT variable of each gate, var_Undef if not encoded yet
+	vector<Var> _satVar;
+	// compiled simulation program; rebuilt with _dfsList
+	vector<SimInst> _simProg;
+	IdList _simSlot;         // gate id -> value slot
+	vector<size_t> _simVals; // SIM_WORDS words per slot
+	// FEC groups as flat partition: group i holds the literals (id * 2 +
+	// phase) _fecLits[_fecBegin[i] .. _fecBegin[i + 1]); only groups of
+	// two or more gates are kept
+	IdList _fecLits;
+	IdList _fecBegin;
+	bool _fecFresh;          // phases not decided yet
+
+   // for the AIG store
+   void initStore(unsigned, unsigned nEdge = 0);
+   void newGate(unsigned, GateType, unsigned line = 0);
+   unsigned newAig(unsigned, unsigned);
+   void removeGate(unsigned);
+   bool isUndef(unsigned gid) const { return _gateFlag[gid] & GATE_UNDEF; }
+   unsigned faninNum(unsigned) const;
+   void connect(unsigned, int, unsigned);
+   void setFanin(unsigned, int, unsigned);
+   bool isMerged(unsigned gid) const { return _repr[gid] != makeLit(gid, false); }
+   unsigned findRepr(unsigned);
+   void mergeInto(unsigned, unsigned);
+   void applyMerges();
+   const FanoutIndex& fanoutIndex() const {
+      if (!_foIndex.upToDate(_fanouts)) _foIndex.build(_fanouts);
+      return _foIndex;
+   }
+   void newMark() const { ++_markStamp; }
+   bool isMarked(unsigned gid) const { return _mark[gid] == _markStamp; }
+   void setMark(unsigned gid) const { _mark[gid] = _markStamp; }
 
+   bool parseAag(bool);
+   void strashDefs(IdList &, IdList &);
+   void writeSymbols(ostream&) const;
    void updateOpen(); // update _unusedList, undefList
 	void updateDFS(); // update _dfsList
-	void dfsTraverse(CirGate *const &);
+	void collectDFS(IdList &) const;
+	void dfsTraverse(unsigned, IdList &, IdList &) const;
+	const IdList& dfsOrder(IdList &) const;
+	bool inDFS(unsigned gid) const { return _gateFlag[gid] & GATE_INDFS; }
+	void levelize();
+	void dfsReplace(unsigned, unsigned);
+	void dfsRef(unsigned, unsigned);
+	void dfsDeref(unsigned);
+	bool compactDFS();
+	void printFanin(unsigned, int) const;
+	void printFanout(unsigned, int) const;
 
 	// for optimization
-	void dfsSweep(CirGate *const &);
-	void replaceG0(CirGate* const &);
-	void replaceGG(CirGate* const &, int);
+	void sweepDead(vector<bool> &, bool);
+	void outOfDFS(vector<bool> &) const;
+	void sweepReplaced(const vector<bool> &);
+	void replaceG0(unsigned);
+	void replaceGG(unsigned, int);
+	void queueOpt(unsigned, priority_queue< pair<unsigned, unsigned>,
+	              vector< pair<unsigned, unsigned> >,
+	              greater< pair<unsigned, unsigned> > > &) const;
+	void collectSuper(unsigned, const vector<bool> &, IdList &, IdList &);
+	unsigned balanceAnd(unsigned, unsigned, AigHash &);
 
 	// for simulation
+	size_t* simVal(unsigned gid) { return &_simVals[_simSlot[gid] * SIM_WORDS]; }
+	void compileSim();
 	void patternGen();
+	void setFilePat(const vector< vector<char> >&, unsigned, unsigned);
 	void simulate();
+	void simRun(size_t *) const;
+	void initFecGrps();
+	unsigned numFecGrps() const { return _fecBegin.empty() ? 0 : _fecBegin.size() - 1; }
 	bool divideGrps();
+	bool divideGrps(const vector<const size_t*> &);
 	bool checkPat(const vector< vector<char> >&, unsigned&);
 	void sortFecGrps();
 	
 	// for fraig
-	void mergeGates(CirGate *const &, CirGate *const &);
+	unsigned createAnd(unsigned, unsigned, unsigned, AigHash &);
+	void mergeGates(unsigned, unsigned, bool inv = false,
+	                const char *msg = "Strashing");
+	Var genCNF(SatSolver &, unsigned);
+	lbool proveEq(SatSolver &, unsigned, unsigned, bool, int nConf = -1);
+	lbool proveVars(SatSolver &, Var, Var, bool, int nConf = -1);
+	void collectReps(const vector<bool> &, vector<int> &, vector<bool> &,
+	                 vector<IdList> &);
+	void recordCex(const SatSolver &, vector<size_t> &, unsigned);
+
+	// for cut enumeration
+	void enumCuts(CutMgr &, unsigned, unsigned);
+
+	// for rewriting
+	unsigned mffcSize(unsigned, const IdList &);
+	void rwrInputs(const Cut &, IdList &);
+	unsigned rwrAnd(unsigned, unsigned, const AigHash &, unsigned);
+	int rwrGain(unsigned, const Cut &, const AigHash &);
+	unsigned rwrBuild(const Cut &, AigHash &);
+
+	// for resubstitution
+	void resubWindow(unsigned, IdList &, IdList &);
+	unsigned resubFind(SatSolver &, unsigned, const IdList &, unsigned,
+	                   vector<size_t> &, unsigned &, unsigned &);
+	void resubCex(const SatSolver &, unsigned, const IdList &, unsigned &, IdList &,
+	              unsigned);
 };
 
 #endif // CIR_MGR_H
@@ -7,8 +7,12 @@
 ****************************************************************************/
 
 #include <cassert>
+#include <algorithm>
+#include <queue>
+#include <sstream>
 #include "cirMgr.h"
 #include "cirGate.h"
+#include "cirHash.h"
 #include "util.h"
 
 using namespace std;
@@ -30,16 +34,26 @@ using namespace std;
 // Remove unused gates
 // DFS list should NOT be changed
 // UNDEF, float and unused list may be changed
+// The gates to remove are the AIGs out of the DFS cone, whose flag
+// already marks what the POs reach, and the UNDEF gates only they use.
+// They go in one pass over the store, and every fanout list is filtered
+// once. The log lines, if asked for, are collected and written at once.
 void
-CirMgr::sweep()
+CirMgr::sweep(bool verbose)
 {
-	for(unsigned i = 0, n = _unusedList.size(); i < n; ++i)
-		dfsSweep(_unusedList[i]);
-	updateOpen();
+	vector<bool> dead(_gateType.size(), false);
+	for(unsigned g = 1, n = _gateType.size(); g < n; ++g)
+		dead[g] = (_gateType[g] == AIG_GATE && !isUndef(g) && !inDFS(g));
+	sweepDead(dead, verbose);
 }
 
-// Recursively simplifying from POs;
-// _dfsList needs to be reconstructed afterwards
+// Simplify with a worklist ordered by DFS position, so a gate is looked
+// at after its fanins. Only the gates whose fanins changed since the last
+// call (all of them after a read) are seeded, and the fanouts of every
+// replaced gate are queued in turn. This reaches the fixed point, e.g.
+// the identical fanins strash leaves behind, in time linear in the
+// affected region.
+// Replaced gates leave the DFS cone without a new traversal.
 // UNDEF gates may be delete if its fanout becomes empty...
 void
 CirMgr::optimize()
@@ -48,129 +62,376 @@ CirMgr::optimize()
 	// 2. fanin has constant 0 -> replace with 0
 	// 3. identical fanins -> replace with (fanin + phase)
 	// 4. inverted fanins -> replace with 0
-	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
-		if(_dfsList[i]->getType() != AIG_GATE) // note that there are no undefined gates in _dfsList
+	const IdList &seeds = (_optAll ? _dfsList : _optDirty);
+	priority_queue< pair<unsigned, unsigned>, vector< pair<unsigned, unsigned> >,
+	                greater< pair<unsigned, unsigned> > > work; // (position, gate)
+	newMark();
+	for(unsigned i = 0, n = seeds.size(); i < n; ++i)
+		queueOpt(seeds[i], work);
+	while(!work.empty()){
+		unsigned g = work.top().second;
+		work.pop();
+		if(!hasGate(g) || !inDFS(g))
 			continue;
-		
-		CirGate *&g = _dfsList[i];
-		if(g->_faninList[0].gate() == _gates[0]){
-			if(g->_faninList[0].isInv()) // 1.
+
+		unsigned in0 = findRepr(_fanin[0][g]), in1 = findRepr(_fanin[1][g]);
+		bool replaced = (litId(in0) == 0 || litId(in1) == 0 || litId(in0) == litId(in1));
+		for(unsigned s = 0, n = (replaced ? _fanouts.size(g) : 0); s < n; ++s)
+			queueOpt(_fanouts(g, s), work);
+		if(litId(in0) == 0){
+			if(litInv(in0)) // 1.
 				replaceGG(g, 1);
 			else // 2.
 				replaceG0(g);
 		}
-		else if(g->_faninList[1].gate() == _gates[0]){
-			if(g->_faninList[1].isInv()) // 1.
+		else if(litId(in1) == 0){
+			if(litInv(in1)) // 1.
 				replaceGG(g, 0);
 			else // 2.
 				replaceG0(g);
 		}
-		else if(g->_faninList[0].gate() == g->_faninList[1].gate()){
-			if(g->_faninList[0].isInv() == g->_faninList[1].isInv()) // 3.
+		else if(litId(in0) == litId(in1)){
+			if(in0 == in1) // 3.
 				replaceGG(g, 0);
 			else // 4.				
 				replaceG0(g);
 		}
 	}
+	applyMerges();
+	for(unsigned i = 0, n = _optDirty.size(); i < n; ++i)
+		_gateFlag[_optDirty[i]] &= ~GATE_OPTDIRTY;
+	_optDirty.clear();
+	_optAll = false;
 	updateOpen();
-	updateDFS();
+	if(compactDFS())
+		_dfsExact = false;
 }
 
-/***************************************************/
-/*   Private member functions about optimization   */
-/***************************************************/
-void CirMgr::dfsSweep(CirGate *const &g){
-	if(g == 0)
-		return ;
-	// break connection with unused fanouts
-	CirGate *fo;
-	for(int i = g->_fanoutList.size() - 1; i >= 0; --i){
-		fo = g->_fanoutList[i];
-		if(fo->_unused){
-			for(size_t s = 0; s < fo->_faninList.size(); ++s){
-				if(fo->_faninList[s].gate() == g){
-					fo->_faninList.erase(fo->_faninList.begin() + s);
-					break;
-				}
-			}
-			g->_fanoutList.erase(g->_fanoutList.begin() + i);
+// Renumber the gates densely: const 0, the PIs in order, the AIGs by
+// level, the undefined gates and then the POs. Removed gates leave no
+// holes. Names, line numbers, FEC groups and simulation values follow
+// their gates; fanout lists are rebuilt in the order of the parser.
+void
+CirMgr::compact()
+{
+	// AIGs in topological order: the cone of the POs first, then the
+	// gates only reached from unused ones
+	IdList order, stack;
+	newMark();
+	for(unsigned i = 0; i < _nPO; ++i)
+		dfsTraverse(_maxVarId + 1 + i, stack, order);
+	for(unsigned g = 1, n = _gateType.size(); g < n; ++g){
+		if(isAig(g) && !isUndef(g))
+			dfsTraverse(g, stack, order);
+	}
+	IdList level(_gateType.size(), 0);
+	vector< pair<unsigned, unsigned> > aigs; // (level, position in order)
+	for(unsigned k = 0, n = order.size(); k < n; ++k){
+		unsigned g = order[k];
+		if(!isAig(g))
+			continue;
+		for(int i = 0; i < 2; ++i){
+			unsigned l = level[litId(_fanin[i][g])] + 1;
+			if(l > level[g])
+				level[g] = l;
 		}
+		aigs.push_back(make_pair(level[g], k));
 	}
-	
-	// sweep if g is a unused AND gate
-	if(g->getType() == AIG_GATE && g->_fanoutList.empty()){
-		g->_unused = true;
-		for(size_t s = 0; s < g->_faninList.size(); ++s)
-			dfsSweep(g->_faninList[s].gate());
-		
-		if(!g->_undefined)
-			--_nAIG;
-		unsigned index = g->_id;
-		cout << "Sweeping: " << g->getTypeStr() << '(' << index << ") removed...\n";
-		delete _gates[index];
-		_gates[index] = 0;
+	sort(aigs.begin(), aigs.end());
+
+	IdList newId(_gateType.size(), 0);
+	unsigned nId = 1;
+	for(unsigned i = 0; i < _nPI; ++i)
+		newId[_PIList[i]] = nId++;
+	for(unsigned k = 0, n = aigs.size(); k < n; ++k)
+		newId[order[aigs[k].second]] = nId++;
+	for(unsigned g = 1; g <= _maxVarId; ++g){
+		if(hasGate(g) && isUndef(g))
+			newId[g] = nId++;
+	}
+	unsigned maxVarId = nId - 1;
+	for(unsigned i = 0; i < _nPO; ++i)
+		newId[_maxVarId + 1 + i] = maxVarId + 1 + i;
+
+	// move the gates
+	vector<unsigned char> type, flag;
+	IdList fanin[2], line, simSlot;
+	map<unsigned, string> name;
+	type.swap(_gateType);
+	flag.swap(_gateFlag);
+	fanin[0].swap(_fanin[0]);
+	fanin[1].swap(_fanin[1]);
+	line.swap(_gateLine);
+	name.swap(_gateName);
+	simSlot.swap(_simSlot);
+	initStore(maxVarId + 1 + _nPO, _nPO + 2 * _nAIG);
+	_simSlot.assign(_gateType.size(), 0);
+	for(unsigned g = 1, n = type.size(); g < n; ++g){
+		if(type[g] == TOT_GATE)
+			continue;
+		unsigned ng = newId[g];
+		newGate(ng, (GateType)type[g], line[g]);
+		_gateFlag[ng] = flag[g] & GATE_UNDEF;
+		if(g < simSlot.size())
+			_simSlot[ng] = simSlot[g];
 	}
+	for(map<unsigned, string>::iterator it = name.begin(); it != name.end(); ++it)
+		_gateName[newId[it->first]].swap(it->second);
+	for(unsigned i = 0; i < _nPI; ++i)
+		_PIList[i] = newId[_PIList[i]];
+
+	// fanouts are sized first, then connected POs first and the AIGs by id
+	IdList nFanout(_gateType.size(), 0);
+	for(unsigned g = 1, n = type.size(); g < n; ++g){
+		if(type[g] == TOT_GATE)
+			continue;
+		for(unsigned i = 0, m = faninNum(newId[g]); i < m; ++i)
+			++nFanout[newId[litId(fanin[i][g])]];
+	}
+	for(unsigned g = 0, n = _gateType.size(); g < n; ++g)
+		_fanouts.reserve(g, nFanout[g]);
+	for(unsigned i = 0; i < _nPO; ++i){
+		unsigned lit = fanin[0][_maxVarId + 1 + i];
+		connect(maxVarId + 1 + i, 0, makeLit(newId[litId(lit)], litInv(lit)));
+	}
+	for(unsigned k = 0, n = aigs.size(); k < n; ++k){
+		unsigned g = order[aigs[k].second];
+		for(int i = 0; i < 2; ++i)
+			connect(newId[g], i, makeLit(newId[litId(fanin[i][g])], litInv(fanin[i][g])));
+	}
+
+	// FEC groups may still hold gates removed since the last simulation
+	IdList lits, begin(1, 0);
+	for(unsigned grp = 0, n = numFecGrps(); grp < n; ++grp){
+		unsigned first = lits.size();
+		for(unsigned j = _fecBegin[grp]; j < _fecBegin[grp + 1]; ++j){
+			unsigned id = litId(_fecLits[j]);
+			if(id == 0 || type[id] != TOT_GATE)
+				lits.push_back(makeLit(newId[id], litInv(_fecLits[j])));
+		}
+		if(lits.size() - first > 1)
+			begin.push_back(lits.size());
+		else
+			lits.resize(first);
+	}
+	if(numFecGrps()){
+		_fecLits.swap(lits);
+		_fecBegin.swap(begin);
+		sortFecGrps();
+	}
+
+	_maxVarId = maxVarId;
+	updateDFS();
+	updateOpen();
 }
 
-void CirMgr::replaceG0(CirGate* const &g){
-	unsigned index = g->_id;
-	cout << "Simplifying: 0 merging " << index << "...\n";
-	CirGate *temp;
-	// disconnect fanin gates from g
-	for(size_t s = 0; s < g->_faninList.size(); ++s){
-		temp = g->_faninList[s].gate();
-		for(size_t t = 0; t < temp->_fanoutList.size(); ++t){
-			if(temp->_fanoutList[t] == g){
-				temp->_fanoutList.erase(temp->_fanoutList.begin() + t);
-				break;
-			}
+// Rebuild each AND supergate as a tree of minimum depth. A supergate is
+// the tree of ANDs below a root through uncomplemented fanins of gates
+// no other cone gate uses; its leaves are paired lowest level first.
+// Roots are visited in DFS order, so the leaves are balanced already.
+// A tree that would not get shallower is kept as it is. Nodes are
+// hashed as they are built, and the old tree is offered for reuse. The
+// old nodes left out of the cone are swept at the end.
+void
+CirMgr::balance()
+{
+	if(!_dfsExact)
+		updateDFS();
+	vector<bool> wasOut;
+	outOfDFS(wasOut);
+	unsigned oldAig = _nAIG;
+	unsigned oldDepth = 0;
+	for(unsigned i = 0; i < _nPO; ++i)
+		oldDepth = std::max(oldDepth, _level[_maxVarId + 1 + i]);
+
+	vector<bool> absorbed(_gateType.size(), false);
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i];
+		if(!isAig(g) || !inDFS(g))
+			continue;
+		for(unsigned j = 0, m = faninNum(g); j < m; ++j){
+			unsigned f = litId(_fanin[j][g]);
+			if(!litInv(_fanin[j][g]) && isAig(f) && !isUndef(f) && _dfsRef[f] == 1)
+				absorbed[f] = true;
 		}
 	}
-	// connect each fanout of g to const0
-	for(size_t s = 0; s < g->_fanoutList.size(); ++s){
-		temp = g->_fanoutList[s];
-		for(size_t t = 0; t < temp->_faninList.size(); ++t){
-			if(temp->_faninList[t].gate() == g){
-				temp->_faninList[t] = CirGateV(_gates[0], temp->_faninList[t].isInv()); // not sure
-				_gates[0]->_fanoutList.push_back(temp);
-				break;
+
+	AigHash hash(_nAIG);
+	IdList leaves, inner;
+	unsigned nRebuilt = 0;
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned r = _dfsList[i];
+		if(!isAig(r) || isUndef(r) || !inDFS(r) || absorbed[r])
+			continue;
+		collectSuper(r, absorbed, leaves, inner);
+		// levels of the tree as it is, fanins first
+		for(unsigned k = inner.size(); k-- > 0; ){
+			unsigned g = inner[k];
+			_level[g] = 1 + std::max(_level[litId(findRepr(_fanin[0][g]))],
+			                    _level[litId(findRepr(_fanin[1][g]))]);
+		}
+		// distinct leaves; a complementary pair makes the root const 0
+		sort(leaves.begin(), leaves.end());
+		leaves.erase(unique(leaves.begin(), leaves.end()), leaves.end());
+		bool zero = false;
+		for(unsigned k = 1, m = leaves.size(); k < m; ++k)
+			zero |= (leaves[k] == (leaves[k - 1] ^ 1));
+		priority_queue< pair<unsigned, unsigned>, vector< pair<unsigned, unsigned> >,
+		                greater< pair<unsigned, unsigned> > > heap; // (level, literal)
+		for(unsigned k = 0, m = leaves.size(); k < m; ++k)
+			heap.push(make_pair(_level[litId(leaves[k])], leaves[k]));
+		if(!zero){
+			// the depth pairing would give
+			priority_queue< unsigned, vector<unsigned>, greater<unsigned> > depth;
+			for(unsigned k = 0, m = leaves.size(); k < m; ++k)
+				depth.push(_level[litId(leaves[k])]);
+			while(depth.size() > 1){
+				unsigned l = depth.top();
+				depth.pop();
+				l = std::max(l, depth.top()) + 1;
+				depth.pop();
+				depth.push(l);
+			}
+			if(depth.top() >= _level[r]){
+				for(unsigned k = 0, m = inner.size(); k < m; ++k){
+					unsigned g = inner[k];
+					hash.insert(findRepr(_fanin[0][g]), findRepr(_fanin[1][g]), g);
+				}
+				continue;
+			}
+		}
+		// the old tree may be reused below the root
+		for(unsigned k = 1, m = inner.size(); k < m; ++k){
+			unsigned g = inner[k];
+			hash.insert(findRepr(_fanin[0][g]), findRepr(_fanin[1][g]), g);
+		}
+		unsigned lit = 0;
+		if(!zero){
+			while(heap.size() > 1){
+				unsigned a = heap.top().second;
+				heap.pop();
+				unsigned b = heap.top().second;
+				heap.pop();
+				unsigned c = balanceAnd(a, b, hash);
+				heap.push(make_pair(_level[litId(c)], c));
 			}
+			lit = heap.top().second;
 		}
+		dfsReplace(r, litId(lit));
+		mergeInto(r, lit);
+		++nRebuilt;
+	}
+	applyMerges();
+	sweepReplaced(wasOut);
+	updateDFS();
+	unsigned newDepth = 0;
+	for(unsigned i = 0; i < _nPO; ++i)
+		newDepth = std::max(newDepth, _level[_maxVarId + 1 + i]);
+	cout << "Balancing: " << nRebuilt << " supergates rebuilt, max level "
+	     << oldDepth << " -> " << newDepth << ", AIGs " << oldAig << " -> "
+	     << _nAIG << "...\n";
+}
+
+/***************************************************/
+/*   Private member functions about optimization   */
+/***************************************************/
+// Remove the AIGs marked in "dead" and the UNDEF gates only they use
+void CirMgr::sweepDead(vector<bool> &dead, bool verbose){
+	for(unsigned i = 0, n = _undefList.size(); i < n; ++i){
+		unsigned g = _undefList[i], s = 0, m = _fanouts.size(g);
+		while(s < m && dead[_fanouts(g, s)])
+			++s;
+		dead[g] = (s == m);
+	}
+	_fanouts.eraseIf(dead);
+	ostringstream log;
+	for(unsigned g = 1, n = _gateType.size(); g < n; ++g){
+		if(!dead[g])
+			continue;
+		if(verbose)
+			log << "Sweeping: " << getTypeStr(g) << '(' << g << ") removed...\n";
+		if(!isUndef(g))
+			--_nAIG;
+		removeGate(g);
 	}
-	delete _gates[index];
-	_gates[index] = 0;
-	--_nAIG;
+	cout << log.str();
+	updateOpen();
+}
+
+// Gates out of the DFS cone, taken before a pass that replaces cones
+void CirMgr::outOfDFS(vector<bool> &out) const{
+	out.resize(_gateType.size());
+	for(unsigned g = 0, n = _gateType.size(); g < n; ++g)
+		out[g] = !inDFS(g);
+}
+
+// Remove the AIGs a pass took out of the DFS cone, or built and then
+// left out; those already out before it ("wasOut") stay
+void CirMgr::sweepReplaced(const vector<bool> &wasOut){
+	vector<bool> dead(_gateType.size(), false);
+	for(unsigned g = 1, n = _gateType.size(); g < n; ++g){
+		dead[g] = (_gateType[g] == AIG_GATE && !isUndef(g) && !inDFS(g) &&
+		           !(g < wasOut.size() && wasOut[g]));
+	}
+	sweepDead(dead, false);
+}
+
+// Queue a cone AIG once per optimize()
+void CirMgr::queueOpt(unsigned g, priority_queue< pair<unsigned, unsigned>,
+                      vector< pair<unsigned, unsigned> >,
+                      greater< pair<unsigned, unsigned> > > &work) const{
+	if(!hasGate(g) || _gateType[g] != AIG_GATE || !inDFS(g) || isMarked(g))
+		return ;
+	setMark(g);
+	work.push(make_pair(_dfsPos[g], g));
 }
 
-void CirMgr::replaceGG(CirGate* const &g, int fi){
-	unsigned index = g->_id;
-	CirGate *temp = g->_faninList[fi].gate();
-	cout << "Simplifying: " << temp->_id << " merging ";
-	if(g->_faninList[fi].isInv())
+void CirMgr::replaceG0(unsigned g){
+	cout << "Simplifying: 0 merging " << g << "...\n";
+	dfsReplace(g, 0);
+	mergeInto(g, 0);
+}
+void CirMgr::replaceGG(unsigned g, int fi){
+	unsigned in = findRepr(_fanin[fi][g]), temp = litId(in);
+	cout << "Simplifying: " << temp << " merging ";
+	if(litInv(in))
 		cout << '!';
-	cout << index << "...\n";
-	// disconnect the fanin gate
-	for(size_t s = 0; s < temp->_fanoutList.size(); ++s){
-		if(temp->_fanoutList[s] == g){
-			temp->_fanoutList.erase(temp->_fanoutList.begin() + s);
-			break;
+	cout << g << "...\n";
+	dfsReplace(g, temp);
+	mergeInto(g, in);
+}
+
+// Leaves of the supergate of "r" in "leaves", as representatives, and
+// its gates in "inner", r first and every gate before its fanins
+void CirMgr::collectSuper(unsigned r, const vector<bool> &absorbed,
+                          IdList &leaves, IdList &inner){
+	leaves.clear();
+	inner.assign(1, r);
+	for(unsigned k = 0; k < inner.size(); ++k){
+		for(int i = 0; i < 2; ++i){
+			unsigned lit = _fanin[i][inner[k]];
+			if(!litInv(lit) && absorbed[litId(lit)])
+				inner.push_back(litId(lit));
+			else
+				leaves.push_back(findRepr(lit));
 		}
 	}
-	// connect fanouts of g with the fanin gate
-	for(size_t s = 0; s < g->_fanoutList.size(); ++s){
-		CirGate *temp2 = g->_fanoutList[s];
-		temp->_fanoutList.push_back(temp2);
-		for(size_t t = 0; t < temp2->_faninList.size(); ++t){
-			if(temp2->_faninList[t].gate() == g){
-				if(temp2->_faninList[t].isInv() == g->_faninList[fi].isInv())
-					temp2->_faninList[t] = CirGateV(temp, 0);
-				else
-					temp2->_faninList[t] = CirGateV(temp, 1);
-				break;
-			}
-		}
+}
+
+// Literal of (a & b) for balance(): folded, hashed, or a new gate out of
+// the cone; its level is set from the fanins
+unsigned CirMgr::balanceAnd(unsigned a, unsigned b, AigHash &hash){
+	if(a == 0 || b == 0 || a == (b ^ 1))
+		return 0;
+	if(a == 1)
+		return b;
+	if(b == 1 || a == b)
+		return a;
+	unsigned g = hash.find(a, b);
+	if(!g){
+		g = newAig(a, b);
+		hash.insert(a, b, g);
 	}
-	delete _gates[index];
-	_gates[index] = 0;
-	--_nAIG;
-}
\ No newline at end of file
+	_level[g] = 1 + std::max(_level[litId(a)], _level[litId(b)]);
+	return makeLit(g, false);
+}
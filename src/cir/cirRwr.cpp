@@ -0,0 +1,405 @@
+/****************************************************************************
+  FileName     [ cirRwr.cpp ]
+  PackageName  [ cir ]
+  Synopsis     [ Define the NPN library and cut rewriting of cir package ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2012-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <map>
+#include <algorithm>
+#include <cassert>
+#include "cirMgr.h"
+#include "cirGate.h"
+#include "cirCut.h"
+#include "cirHash.h"
+#include "cirRwr.h"
+
+using namespace std;
+
+/*******************************/
+/*   Global variable and enum  */
+/*******************************/
+// formulas of up to this many ANDs are searched exhaustively; the few
+// functions beyond are split by Shannon expansion
+#define RWR_MAX_COST 10
+// priority cuts kept per gate
+#define RWR_CUTS     8
+// literal of a node that is not in the circuit yet
+#define RWR_NONE     (~0u)
+
+/**************************************/
+/*   Static varaibles and functions   */
+/**************************************/
+static const unsigned varTT[4] = { 0xAAAA, 0xCCCC, 0xF0F0, 0xFF00 };
+static unsigned char perms[24][4];
+
+static void
+initPerms()
+{
+   unsigned n = 0;
+   for(unsigned a = 0; a < 4; ++a)
+      for(unsigned b = 0; b < 4; ++b)
+         for(unsigned c = 0; c < 4; ++c){
+            unsigned d = 6 - a - b - c;
+            if(a == b || a == c || b == c || d > 3 || d == a || d == b || d == c)
+               continue;
+            perms[n][0] = a;
+            perms[n][1] = b;
+            perms[n][2] = c;
+            perms[n][3] = d;
+            ++n;
+         }
+   assert(n == 24);
+}
+
+// g(x) = out ^ f(y) with y_i = x_perm(i) ^ bit i of neg
+static unsigned
+npnTransform(unsigned f, unsigned p, unsigned neg, bool out)
+{
+   unsigned g = 0;
+   for(unsigned x = 0; x < 16; ++x){
+      unsigned y = 0;
+      for(unsigned i = 0; i < 4; ++i)
+         y |= (((x >> perms[p][i]) & 1) ^ ((neg >> i) & 1)) << i;
+      g |= ((f >> y) & 1) << x;
+   }
+   return out ? g ^ 0xFFFF : g;
+}
+
+// Cheapest AND formula of every function up to complement, keyed by the
+// phase with bit 15 clear: f = (_g[f] ^ pg) & (_h[f] ^ ph), complemented
+// if bit 2 of _ph[f] is set; bit 0 and bit 1 tell if pg and ph are all
+// ones
+struct FormulaTable
+{
+   vector<unsigned char>   _cost;   // 255 if not reached
+   vector<unsigned short>  _g;
+   vector<unsigned short>  _h;
+   vector<unsigned char>   _ph;
+
+   FormulaTable();
+   static unsigned norm(unsigned f) { return (f & 0x8000) ? f ^ 0xFFFF : f; }
+};
+
+// Level c holds the functions of c ANDs: every AND of two functions whose
+// costs add up to c - 1, in all four phases, that is not cheaper already
+FormulaTable::FormulaTable()
+{
+   _cost.assign(0x8000, 255);
+   _g.assign(0x8000, 0);
+   _h.assign(0x8000, 0);
+   _ph.assign(0x8000, 0);
+   vector< vector<unsigned> > level(1);
+   _cost[0] = 0;
+   level[0].push_back(0);
+   for(unsigned i = 0; i < 4; ++i){
+      _cost[norm(varTT[i])] = 0;
+      level[0].push_back(norm(varTT[i]));
+   }
+   for(unsigned c = 1; c <= RWR_MAX_COST; ++c){
+      level.push_back(vector<unsigned>());
+      for(unsigned a = 0; a <= (c - 1) / 2; ++a){
+         const vector<unsigned> &la = level[a], &lb = level[c - 1 - a];
+         for(size_t i = 0, n = la.size(); i < n; ++i){
+            for(size_t j = (a == c - 1 - a ? i : 0), m = lb.size(); j < m; ++j){
+               for(unsigned ph = 0; ph < 4; ++ph){
+                  unsigned g = la[i] ^ ((ph & 1) ? 0xFFFF : 0);
+                  unsigned h = lb[j] ^ ((ph & 2) ? 0xFFFF : 0);
+                  unsigned f = norm(g & h);
+                  if(_cost[f] != 255)
+                     continue;
+                  _cost[f] = c;
+                  _g[f] = la[i];
+                  _h[f] = lb[j];
+                  _ph[f] = ph | (f != (g & h) ? 4 : 0);
+                  level[c].push_back(f);
+               }
+            }
+         }
+      }
+   }
+}
+
+// Builds a RwrGraph, hashing its ANDs so equal subformulas are shared
+class RwrBuilder
+{
+public:
+   RwrBuilder(const FormulaTable &tab, RwrGraph &g) : _tab(tab), _g(g) {}
+
+   unsigned build(unsigned f);
+
+private:
+   const FormulaTable                  &_tab;
+   RwrGraph                            &_g;
+   map<pair<unsigned, unsigned>, unsigned> _hash;
+
+   unsigned andLit(unsigned a, unsigned b);
+};
+
+unsigned
+RwrBuilder::andLit(unsigned a, unsigned b)
+{
+   if(a == 0 || b == 0 || a == (b ^ 1))
+      return 0;
+   if(a == 1)
+      return b;
+   if(b == 1 || a == b)
+      return a;
+   if(a > b)
+      swap(a, b);
+   map<pair<unsigned, unsigned>, unsigned>::iterator it = _hash.find(make_pair(a, b));
+   if(it != _hash.end())
+      return it->second;
+   unsigned lit = 2 * (5 + _g.size());
+   assert(lit < 256);
+   _g._fanin.push_back(a);
+   _g._fanin.push_back(b);
+   _hash[make_pair(a, b)] = lit;
+   return lit;
+}
+
+// Local literal computing the 16-bit function "f"
+unsigned
+RwrBuilder::build(unsigned f)
+{
+   unsigned n = FormulaTable::norm(f), inv = (n != f);
+   if(n == 0)
+      return inv;
+   for(unsigned i = 0; i < 4; ++i){
+      if(f == varTT[i])
+         return 2 * (1 + i);
+      if(f == (varTT[i] ^ 0xFFFF))
+         return 2 * (1 + i) + 1;
+   }
+   if(_tab._cost[n] != 255){
+      unsigned g = _tab._g[n] ^ ((_tab._ph[n] & 1) ? 0xFFFF : 0);
+      unsigned h = _tab._h[n] ^ ((_tab._ph[n] & 2) ? 0xFFFF : 0);
+      return andLit(build(g), build(h)) ^ inv ^ (_tab._ph[n] >> 2);
+   }
+   // f = !(!(x & f1) & !(!x & f0)) on the variable with the cheapest
+   // cofactors
+   unsigned best = 0, bestCost = ~0u, f0 = 0, f1 = 0;
+   for(unsigned i = 0; i < 4; ++i){
+      unsigned s = 1u << i, m = varTT[i];
+      unsigned c1 = (f & m) | ((f & m) >> s), c0 = (f & ~m & 0xFFFF) | ((f & ~m & 0xFFFF) << s);
+      unsigned cost = _tab._cost[FormulaTable::norm(c1)] + _tab._cost[FormulaTable::norm(c0)];
+      if(cost < bestCost){
+         bestCost = cost;
+         best = i;
+         f1 = c1;
+         f0 = c0;
+      }
+   }
+   unsigned x = 2 * (1 + best);
+   unsigned t1 = andLit(x, build(f1)), t0 = andLit(x ^ 1, build(f0));
+   return andLit(t1 ^ 1, t0 ^ 1) ^ 1;
+}
+
+/*****************************************/
+/*   Member functions of class RwrLib    */
+/*****************************************/
+const RwrLib& RwrLib::instance(){
+   static RwrLib lib;
+   return lib;
+}
+
+unsigned RwrLib::perm(unsigned truth, unsigned i) const{
+   return perms[_trans[truth & 0xFFFF] & 0x1F][i];
+}
+
+// Functions are visited in increasing order, so the first one of each
+// orbit under the 768 NPN transforms is its smallest and represents it
+RwrLib::RwrLib(){
+   initPerms();
+   FormulaTable tab;
+   _class.assign(0x10000, 0);
+   _trans.assign(0x10000, 0);
+   vector<bool> done(0x10000, false);
+   for(unsigned f = 0; f < 0x10000; ++f){
+      if(done[f])
+         continue;
+      unsigned id = _graphs.size();
+      for(unsigned p = 0; p < 24; ++p)
+         for(unsigned neg = 0; neg < 16; ++neg)
+            for(unsigned out = 0; out < 2; ++out){
+               unsigned g = npnTransform(f, p, neg, out);
+               if(done[g])
+                  continue;
+               done[g] = true;
+               _class[g] = id;
+               _trans[g] = p | (neg << 5) | (out << 9);
+            }
+      _graphs.push_back(RwrGraph());
+      RwrBuilder b(tab, _graphs.back());
+      _graphs.back()._root = b.build(f);
+   }
+   assert(_graphs.size() == 222);
+}
+
+/**************************************************/
+/*   Public member functions about optimization   */
+/**************************************************/
+// Replace the cone of each AIG over one of its 4-input cuts with the
+// library graph of the cut function when that takes fewer AIGs. The gates
+// that only feed the cone (its MFFC) leave the DFS cone; nodes of the
+// graph already in the circuit are reused through a structural hash.
+// Gates are visited in DFS order and see the rewrites of their fanins.
+// The replaced MFFCs are swept at the end. New gates go to the end of
+// the store, past the POs; CIRCompact renumbers them densely.
+void
+CirMgr::rewrite()
+{
+	if(!_dfsExact)
+		updateDFS();
+	vector<bool> wasOut;
+	outOfDFS(wasOut);
+	unsigned oldAig = _nAIG;
+	CutMgr cuts;
+	enumCuts(cuts, 4, RWR_CUTS);
+	AigHash hash(_nAIG);
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i];
+		if(isAig(g) && !isUndef(g) && inDFS(g))
+			hash.insert(_fanin[0][g], _fanin[1][g], g);
+	}
+
+	unsigned nCone = 0;
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i];
+		if(!isAig(g) || isUndef(g) || !inDFS(g))
+			continue;
+		int bestGain = 0;
+		unsigned best = 0;
+		for(unsigned c = 1, m = cuts.numCuts(g); c < m; ++c){
+			int gain = rwrGain(g, cuts.getCut(g, c), hash);
+			if(gain > bestGain){
+				bestGain = gain;
+				best = c;
+			}
+		}
+		if(!best)
+			continue;
+		unsigned r = rwrBuild(cuts.getCut(g, best), hash);
+		dfsReplace(g, litId(r));
+		mergeInto(g, r);
+		++nCone;
+	}
+	applyMerges();
+	sweepReplaced(wasOut);
+	updateDFS();
+	cout << "Rewriting: " << nCone << " cones replaced, AIGs " << oldAig
+	     << " -> " << _nAIG << "...\n";
+}
+
+/***************************************************/
+/*   Private member functions about rewriting      */
+/***************************************************/
+// Gates that leave the cone with "g" when "leaves" stay, "g" included.
+// They are marked; _dfsRef is left as it was.
+unsigned CirMgr::mffcSize(unsigned g, const IdList &leaves){
+	newMark();
+	setMark(g);
+	IdList cone(1, g), touched;
+	for(unsigned k = 0; k < cone.size(); ++k){
+		for(int i = 0; i < 2; ++i){
+			unsigned f = litId(findRepr(_fanin[i][cone[k]]));
+			if(!isAig(f) || isUndef(f) || find(leaves.begin(), leaves.end(), f) != leaves.end())
+				continue;
+			touched.push_back(f);
+			if(--_dfsRef[f] == 0){
+				setMark(f);
+				cone.push_back(f);
+			}
+		}
+	}
+	for(unsigned k = 0, n = touched.size(); k < n; ++k)
+		++_dfsRef[touched[k]];
+	return cone.size();
+}
+
+// Literals of the library graph inputs for "cut", const 0 first: input i
+// is leaf perm(i) in the phase neg() gives. Inputs beyond the leaves do
+// not matter and are tied to const 0.
+void CirMgr::rwrInputs(const Cut &cut, IdList &lits){
+	const RwrLib &lib = RwrLib::instance();
+	lits.assign(1, 0);
+	for(unsigned i = 0; i < 4; ++i){
+		unsigned p = lib.perm(cut._truth, i);
+		unsigned lit = (p < cut._size ? findRepr(makeLit(cut._leaves[p], false)) : 0);
+		lits.push_back(lit ^ ((lib.neg(cut._truth) >> i) & 1));
+	}
+}
+
+// Literal of (a & b) if the circuit has it: folded, or an AND in the cone
+// or one of the gates from "nNew" on; RWR_NONE otherwise
+unsigned CirMgr::rwrAnd(unsigned a, unsigned b, const AigHash &hash, unsigned nNew){
+	if(a == 0 || b == 0 || a == (b ^ 1))
+		return 0;
+	if(a == 1)
+		return b;
+	if(b == 1 || a == b)
+		return a;
+	unsigned h = hash.find(a, b);
+	if(!h)
+		return RWR_NONE;
+	unsigned lit = findRepr(makeLit(h, false));
+	return (inDFS(litId(lit)) || litId(lit) >= nNew ? lit : RWR_NONE);
+}
+
+// AIGs saved by putting the graph of "cut" in place of "g": the MFFC
+// less the new nodes and the MFFC nodes the graph keeps. 0 if there is no
+// saving or the graph would refer to "g".
+int CirMgr::rwrGain(unsigned g, const Cut &cut, const AigHash &hash){
+	// a leaf may have left the cone by an earlier rewrite
+	IdList leaves;
+	for(unsigned l = 0; l < cut._size; ++l){
+		unsigned f = litId(findRepr(makeLit(cut._leaves[l], false)));
+		if(isAig(f) && !isUndef(f) && !inDFS(f))
+			return 0;
+		leaves.push_back(f);
+	}
+	int saved = mffcSize(g, leaves), added = 0;
+	const RwrLib &lib = RwrLib::instance();
+	const RwrGraph &graph = lib.graph(cut._truth);
+	IdList lits;
+	rwrInputs(cut, lits);
+	for(unsigned k = 0, n = graph.size(); k < n; ++k){
+		unsigned fa = graph._fanin[2 * k], fb = graph._fanin[2 * k + 1];
+		unsigned a = lits[fa >> 1], b = lits[fb >> 1], lit = RWR_NONE;
+		if(a != RWR_NONE && b != RWR_NONE)
+			lit = rwrAnd(a ^ (fa & 1), b ^ (fb & 1), hash, _gateType.size());
+		if(lit != RWR_NONE && litId(lit) == g)
+			return 0;
+		if(lit == RWR_NONE || isMarked(litId(lit)))
+			++added;
+		if(added >= saved)
+			return 0;
+		lits.push_back(lit);
+	}
+	unsigned root = lits[graph._root >> 1];
+	if(root != RWR_NONE && litId(root) == g)
+		return 0;
+	return saved - added;
+}
+
+// Build the graph of "cut" in the circuit and return its output literal
+unsigned CirMgr::rwrBuild(const Cut &cut, AigHash &hash){
+	const RwrLib &lib = RwrLib::instance();
+	const RwrGraph &graph = lib.graph(cut._truth);
+	unsigned nNew = _gateType.size();
+	IdList lits;
+	rwrInputs(cut, lits);
+	for(unsigned k = 0, n = graph.size(); k < n; ++k){
+		unsigned fa = graph._fanin[2 * k], fb = graph._fanin[2 * k + 1];
+		unsigned a = lits[fa >> 1] ^ (fa & 1), b = lits[fb >> 1] ^ (fb & 1);
+		unsigned lit = rwrAnd(a, b, hash, nNew);
+		if(lit == RWR_NONE){
+			unsigned id = newAig(a, b);
+			hash.insert(a, b, id);
+			lit = makeLit(id, false);
+		}
+		lits.push_back(lit);
+	}
+	return lits[graph._root >> 1] ^ (graph._root & 1) ^ lib.outNeg(cut._truth);
+}
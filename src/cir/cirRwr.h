@@ -0,0 +1,54 @@
+/****************************************************************************
+  FileName     [ cirRwr.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define the NPN library of 4-input AIGs for rewriting ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2012-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_RWR_H
+#define CIR_RWR_H
+
+#include <vector>
+#include "cirDef.h"
+
+using namespace std;
+
+// A small AIG over 4 inputs in local literals (2 * var + phase): var 0 is
+// const 0, vars 1..4 are the inputs and var 5 + k is the k-th AND, whose
+// fanins are _fanin[2k] and _fanin[2k + 1]. Nodes come in topological
+// order.
+struct RwrGraph
+{
+   vector<unsigned char>   _fanin;
+   unsigned char           _root;
+
+   unsigned size() const { return _fanin.size() / 2; }
+};
+
+// One graph for each of the 222 NPN classes of 4-input functions. A
+// function is the graph of its class with input i fed by leaf perm(i),
+// complemented if bit i of neg() is set, and the output complemented if
+// outNeg(). Built on first use.
+class RwrLib
+{
+public:
+   static const RwrLib& instance();
+
+   unsigned numClasses() const { return _graphs.size(); }
+   const RwrGraph& graph(unsigned truth) const {
+      return _graphs[_class[truth & 0xFFFF]];
+   }
+   unsigned perm(unsigned truth, unsigned i) const;
+   unsigned neg(unsigned truth) const { return (_trans[truth & 0xFFFF] >> 5) & 0xF; }
+   bool outNeg(unsigned truth) const { return _trans[truth & 0xFFFF] >> 9; }
+
+private:
+   RwrLib();
+
+   vector<unsigned char>   _class;  // truth table -> class
+   vector<unsigned short>  _trans;  // permutation | neg << 5 | outNeg << 9
+   vector<RwrGraph>        _graphs;
+};
+
+#endif // CIR_RWR_H
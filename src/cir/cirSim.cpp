@@ -11,8 +11,12 @@
 #include <iomanip>
 #include <algorithm>
 #include <cassert>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "cirMgr.h"
 #include "cirGate.h"
+#include "cirSimd.h"
 #include "util.h"
 
 using namespace std;
@@ -24,38 +28,137 @@ using namespace std;
 /*   Global variable and enum  */
 /*******************************/
 #define MAX_USELESS 10
-#define WORD_SIZE   (sizeof(size_t) * 8)
 
 /**************************************/
 /*   Static varaibles and functions   */
 /**************************************/
+// A member of a FEC group keyed by its phase-adjusted simulation values;
+// sorting brings members with equal values next to each other. _val
+// points into batch 0; the other batches hold the values at the same
+// offset.
+struct FecSig
+{
+	size_t _hash;
+	const size_t *_val;
+	size_t _mask;
+	unsigned _lit;
+};
+
+static inline int
+fecSigCmp(const FecSig &a, const FecSig &b, const vector<const size_t*> &vals)
+{
+	for(unsigned w = 0; w < SIM_WORDS; ++w){
+		size_t x = a._val[w] ^ a._mask, y = b._val[w] ^ b._mask;
+		if(x != y)
+			return x < y ? -1 : 1;
+	}
+	size_t offA = a._val - vals[0], offB = b._val - vals[0];
+	for(unsigned t = 1, n = vals.size(); t < n; ++t){
+		for(unsigned w = 0; w < SIM_WORDS; ++w){
+			size_t x = vals[t][offA + w] ^ a._mask, y = vals[t][offB + w] ^ b._mask;
+			if(x != y)
+				return x < y ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+struct FecSigLess
+{
+	const vector<const size_t*> &_vals;
+
+	FecSigLess(const vector<const size_t*> &vals) : _vals(vals) {}
+	bool operator() (const FecSig &a, const FecSig &b) const {
+		if(a._hash != b._hash)
+			return a._hash < b._hash;
+		int c = fecSigCmp(a, b, _vals);
+		return c ? c < 0 : a._lit < b._lit;
+	}
+};
+
+static inline bool
+fecSigEqual(const FecSig &a, const FecSig &b, const vector<const size_t*> &vals)
+{
+	return a._hash == b._hash && fecSigCmp(a, b, vals) == 0;
+}
 
 /************************************************/
 /*   Public member functions about Simulation   */
 /************************************************/
+// Each round simulates "nThread" batches of patterns, batch 0 in
+// _simVals and batch t in a buffer of its own by worker thread t. The
+// workers are started once and wait for each round. The patterns are
+// drawn in batch order and the groups are refined by all batches at once,
+// so the result does not depend on thread timing. A round that divides
+// nothing counts as "nThread" useless batches, so more threads finish the
+// same amount of simulation sooner rather than simulating more.
+// "nThread" is clamped to the hardware threads.
 void
-CirMgr::randomSim()
+CirMgr::randomSim(unsigned nThread)
 {
+	assert(nThread >= 1);
+	unsigned nHw = thread::hardware_concurrency();
+	if(nHw && nThread > nHw)
+		nThread = nHw;
 	// put all gates into a single FEC group
-	_fecGrps.clear();
-	_fecGrps.resize(1);
-	_fecGrps[0].push_back(&_gates[0]->_wires[0]);
-	_fecGrps[0].push_back(&_gates[0]->_wires[1]);
-	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
-		if(_dfsList[i]->getType() == AIG_GATE){
-			_fecGrps[0].push_back(&_dfsList[i]->_wires[0]);
-			_fecGrps[0].push_back(&_dfsList[i]->_wires[1]);
-		}
+	initFecGrps();
+	vector< vector<size_t> > batches(nThread - 1, vector<size_t>(_simVals.size(), 0));
+	vector<const size_t*> vals(1, &_simVals[0]);
+	for(unsigned t = 0; t + 1 < nThread; ++t)
+		vals.push_back(&batches[t][0]);
+
+	mutex mtx;
+	condition_variable start, finish;
+	unsigned round = 0, nDone = 0;
+	bool stop = false;
+	vector<thread> workers;
+	for(unsigned t = 0; t + 1 < nThread; ++t){
+		workers.push_back(thread([&, t](){
+			for(unsigned seen = 0; ; ++seen){
+				{
+					unique_lock<mutex> lock(mtx);
+					start.wait(lock, [&](){ return stop || round > seen; });
+					if(stop)
+						return ;
+				}
+				simRun(&batches[t][0]);
+				lock_guard<mutex> lock(mtx);
+				if(++nDone == nThread - 1)
+					finish.notify_one();
+			}
+		}));
 	}
+
 	// perform simulation to divide FEC groups
 	unsigned patNum = 0;
 	unsigned useless = 0;
 	while(useless < MAX_USELESS){
 		patternGen();
+		for(unsigned t = 0; t + 1 < nThread; ++t){
+			for(unsigned i = 0; i < _nPI; ++i)
+				_simGen.fill(&batches[t][_simSlot[_PIList[i]] * SIM_WORDS], SIM_WORDS);
+		}
+		{
+			lock_guard<mutex> lock(mtx);
+			nDone = 0;
+			++round;
+		}
+		start.notify_all();
 		simulate();
-		useless = (divideGrps() ? 0 : useless + 1);
-		patNum += WORD_SIZE;
+		{
+			unique_lock<mutex> lock(mtx);
+			finish.wait(lock, [&](){ return nDone == nThread - 1; });
+		}
+		useless = (divideGrps(vals) ? 0 : useless + nThread);
+		patNum += nThread * WORD_SIZE * SIM_WORDS;
 	}
+	{
+		lock_guard<mutex> lock(mtx);
+		stop = true;
+	}
+	start.notify_all();
+	for(unsigned t = 0, n = workers.size(); t < n; ++t)
+		workers[t].join();
 	sortFecGrps();
 	cout << patNum << " patterns simulated.\n";
 }
@@ -92,7 +195,8 @@ CirMgr::fileSim(ifstream& patternFile)
 	
 //	cerr << "1\n";
 
-	_fecGrps.clear();
+	_fecLits.clear();
+	_fecBegin.clear();
 	// check the correctness of patterns
 	unsigned patNum = 0;
 	cursor = 0;
@@ -103,26 +207,11 @@ CirMgr::fileSim(ifstream& patternFile)
 
 //	cerr << "2\n";
 	// put all gates into a single FEC group
-	_fecGrps.resize(1);
-	_fecGrps[0].push_back(&_gates[0]->_wires[0]);
-	_fecGrps[0].push_back(&_gates[0]->_wires[1]);
-	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
-		if(_dfsList[i]->getType() == AIG_GATE){
-			_fecGrps[0].push_back(&_dfsList[i]->_wires[0]);
-			_fecGrps[0].push_back(&_dfsList[i]->_wires[1]);
-		}
-	}
+	initFecGrps();
 
 //	cerr << "3\n";
 	// generate patterns to PIs
-	for(unsigned i = 0; i < _nPI; ++i)
-		_gates[_PIList[i]]->_value = 0;
-	for(unsigned i = cursor; i < patNum; ++i){
-		for(unsigned j = 0; j < _nPI; ++j){
-			if(patterns[i][j] == '1')
-				_gates[_PIList[j]]->_value |= ((size_t)1 << (i - cursor));
-		}
-	}
+	setFilePat(patterns, cursor, patNum);
 	
 //	cerr << "4\n";
 
@@ -133,27 +222,19 @@ CirMgr::fileSim(ifstream& patternFile)
 //	cerr << "6\n";
 	if(patNum == patterns.size()){
 		sortFecGrps();
-		cout << "\nTotal #FEC Group = " << _fecGrps.size() << endl;
+		cout << "\nTotal #FEC Group = " << numFecGrps() << endl;
 		cout << patNum << " patterns simulated.\n";
 		return ;
 	}
 
 	cursor = patNum;
 	while(checkPat(patterns, patNum)){
-		for(unsigned i = 0; i < _nPI; ++i)
-			_gates[_PIList[i]]->_value = 0;
-		for(unsigned i = cursor; i < patNum; ++i){
-			for(unsigned j = 0; j < _nPI; ++j){
-				if(patterns[i][j] == '1')
-					_gates[_PIList[j]]->_value |= ((size_t)1 << (i - cursor));
-			}
-		}
-		
+		setFilePat(patterns, cursor, patNum);
 		simulate();
 		divideGrps();
 		if(patNum == patterns.size()){
 			sortFecGrps();
-			cout << "\nTotal #FEC Group = " << _fecGrps.size() << endl;
+			cout << "\nTotal #FEC Group = " << numFecGrps() << endl;
 			cout << patNum << " patterns simulated.\n";
 			return ;
 		}
@@ -169,36 +250,153 @@ CirMgr::fileSim(ifstream& patternFile)
 /*************************************************/
 void CirMgr::patternGen(){
 	for(unsigned i = 0, n = _PIList.size(); i < n; ++i)
-		_gates[_PIList[i]]->_value = rnGen(INT_MAX);
+		_simGen.fill(simVal(_PIList[i]), SIM_WORDS);
+}
+
+// Put patterns [from, to) into the first word of each PI; the other words
+// repeat it so they do not add patterns of their own
+void CirMgr::setFilePat(const vector< vector<char> >& patterns, unsigned from, unsigned to){
+	for(unsigned j = 0; j < _nPI; ++j){
+		size_t *v = simVal(_PIList[j]);
+		v[0] = 0;
+		for(unsigned i = from; i < to; ++i){
+			if(patterns[i][j] == '1')
+				v[0] |= ((size_t)1 << (i - from));
+		}
+		for(unsigned w = 1; w < SIM_WORDS; ++w)
+			v[w] = v[0];
+	}
 }
 
+// Run the compiled program. Gates merged by fraig keep their instructions
+// until _dfsList is compacted; they compute the same values as the gates
+// that replaced them, so the program stays valid meanwhile.
 void CirMgr::simulate(){
+	simRun(&_simVals[0]);
+}
+
+// Run the compiled program on a buffer laid out as _simVals whose const 0
+// and PI slots are set; only reads the manager, so threads may share it
+void CirMgr::simRun(size_t *val) const{
+	for(size_t i = 0, n = _simProg.size(); i < n; ++i){
+		const SimInst &op = _simProg[i];
+		simAnd(val + op._out * SIM_WORDS,
+		       val + op._in0 * SIM_WORDS, SIM_MASK(op._inv & 1),
+		       val + op._in1 * SIM_WORDS, SIM_MASK(op._inv & 2));
+	}
+}
+
+// Flatten _dfsList into _simProg. Slot 0 is const 0 (also used by
+// undefined gates and gates out of the DFS cone), followed by the PIs
+// and by the AIGs and POs in DFS order. A PO is an AND of its fanin with
+// itself. Values of gates that keep a slot are carried over.
+void CirMgr::compileSim(){
+	IdList oldSlot;
+	vector<size_t> oldVals;
+	oldSlot.swap(_simSlot);
+	oldVals.swap(_simVals);
+
+	_simSlot.assign(_gateType.size(), 0);
+	unsigned nSlot = 1;
+	for(unsigned i = 0; i < _nPI; ++i)
+		_simSlot[_PIList[i]] = nSlot++;
+	_simProg.clear();
+	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
+		unsigned g = _dfsList[i], nIn = faninNum(g);
+		if(nIn == 0)
+			continue;
+		_simSlot[g] = nSlot++;
+		unsigned in0 = _fanin[0][g], in1 = _fanin[nIn - 1][g];
+		SimInst op;
+		op._out = _simSlot[g];
+		op._in0 = _simSlot[litId(in0)];
+		op._in1 = _simSlot[litId(in1)];
+		op._inv = (litInv(in0) ? 1 : 0) | (litInv(in1) ? 2 : 0);
+		_simProg.push_back(op);
+	}
+
+	_simVals.assign(nSlot * SIM_WORDS, 0);
+	for(unsigned id = 1, n = oldSlot.size(); id < n && id < _gateType.size(); ++id){
+		if(_simSlot[id] && oldSlot[id]){
+			for(unsigned w = 0; w < SIM_WORDS; ++w)
+				_simVals[_simSlot[id] * SIM_WORDS + w] = oldVals[oldSlot[id] * SIM_WORDS + w];
+		}
+	}
+}
+
+// Const 0 and the AIGs in DFS order form the initial group; the phase of
+// each member is decided by its first simulation value
+void CirMgr::initFecGrps(){
+	_fecLits.clear();
+	_fecLits.push_back(0);
 	for(unsigned i = 0, n = _dfsList.size(); i < n; ++i){
-		_dfsList[i]->simulate();
+		if(_gateType[_dfsList[i]] == AIG_GATE && inDFS(_dfsList[i]))
+			_fecLits.push_back(_dfsList[i] * 2);
 	}
+	_fecBegin.clear();
+	_fecBegin.push_back(0);
+	_fecBegin.push_back(_fecLits.size());
+	_fecFresh = true;
 }
 
+// Refine every group by the current simulation values in one pass.
+// A member is keyed by its value XOR its phase, so a gate and its
+// complement fall into the same group. Each group is sorted by key and
+// cut wherever neighbouring keys differ; pieces of a single gate are
+// dropped. Gates merged by fraig leave their groups here.
+// Return true if any group is split or shrunk.
 bool CirMgr::divideGrps(){
-	bool divided = false;
-	for(int i = _fecGrps.size() - 1; i >= 0; --i){
-		HashMap<SimKey, FecGroup> grpsHash(_nAIG);
-		FecGroup grpRef;
-		bool found;
-		for(unsigned j = 0, m = _fecGrps[i].size(); j < m; ++j){
-			FecGroup buf(1, _fecGrps[i][j]);
-			grpsHash.findGrp(*_fecGrps[i][j], buf, found).push_back(_fecGrps[i][j]);
+	return divideGrps(vector<const size_t*>(1, &_simVals[0]));
+}
+
+// Refine by several batches of values laid out as _simVals, batch 0 being
+// _simVals itself: members stay together only if they agree in all of them
+bool CirMgr::divideGrps(const vector<const size_t*> &vals){
+	if(_fecFresh){
+		for(unsigned i = 0, n = _fecLits.size(); i < n; ++i){
+			unsigned id = _fecLits[i] >> 1;
+			_fecLits[i] = id * 2 + (getSimVal(id)[0] & 1);
 		}
+		_fecFresh = false;
+	}
 
-		HashMap<SimKey, FecGroup>::iterator it = grpsHash.begin();
-		if((*it).second.size() < _fecGrps[i].size()){
-			divided = true;
-			_fecGrps.erase(_fecGrps.begin() + i);
-			for(; it != grpsHash.end(); ++it){
-				if((*it).second.size() > 1 && !(*it).second[0]->_inv)
-					_fecGrps.push_back((*it).second);
+	IdList lits, begin;
+	lits.reserve(_fecLits.size());
+	begin.reserve(_fecBegin.size());
+	begin.push_back(0);
+	vector<FecSig> sigs;
+	for(unsigned g = 0, n = numFecGrps(); g < n; ++g){
+		sigs.clear();
+		for(unsigned i = _fecBegin[g]; i < _fecBegin[g + 1]; ++i){
+			unsigned lit = _fecLits[i];
+			if(!hasGate(lit >> 1) || isMerged(lit >> 1))
+				continue;
+			FecSig sig;
+			size_t off = _simSlot[lit >> 1] * SIM_WORDS;
+			sig._val = vals[0] + off;
+			sig._mask = SIM_MASK(lit & 1);
+			sig._hash = simHash(sig._val, sig._mask);
+			for(unsigned t = 1, nt = vals.size(); t < nt; ++t)
+				sig._hash = sig._hash * size_t(0x9e3779b97f4a7c15ULL) ^ simHash(vals[t] + off, sig._mask);
+			sig._lit = lit;
+			sigs.push_back(sig);
+		}
+		sort(sigs.begin(), sigs.end(), FecSigLess(vals));
+		for(size_t i = 0, m = sigs.size(); i < m; ){
+			size_t j = i + 1;
+			while(j < m && fecSigEqual(sigs[i], sigs[j], vals))
+				++j;
+			if(j - i > 1){
+				for(size_t k = i; k < j; ++k)
+					lits.push_back(sigs[k]._lit);
+				begin.push_back(lits.size());
 			}
+			i = j;
 		}
 	}
+	bool divided = (lits.size() != _fecLits.size() || begin.size() != _fecBegin.size());
+	_fecLits.swap(lits);
+	_fecBegin.swap(begin);
 	return divided;
 }
 
@@ -230,18 +428,24 @@ bool CirMgr::checkPat(const vector< vector<char> >& patterns, unsigned &patNum){
 	return true;
 }
 
+// Order members of each group by id and the groups by their first member
 void CirMgr::sortFecGrps(){
-	// sort _fecGrps
-	FecGroup tmp;
-	for(unsigned i = 1, n = _fecGrps.size(); i < n; ++i){
-		for(unsigned j = i; j > 0; --j){
-			if(_fecGrps[j][0]->_id < _fecGrps[j - 1][0]->_id){
-				tmp = _fecGrps[j];
-				_fecGrps[j] = _fecGrps[j - 1];
-				_fecGrps[j - 1] = tmp;
-			}
-			else
-				break;
-		}
+	vector< pair<unsigned, unsigned> > order; // (first id, group)
+	for(unsigned g = 0, n = numFecGrps(); g < n; ++g){
+		sort(_fecLits.begin() + _fecBegin[g], _fecLits.begin() + _fecBegin[g + 1]);
+		order.push_back(make_pair(_fecLits[_fecBegin[g]], g));
 	}
-}
\ No newline at end of file
+	sort(order.begin(), order.end());
+
+	IdList lits, begin;
+	lits.reserve(_fecLits.size());
+	begin.reserve(_fecBegin.size());
+	begin.push_back(0);
+	for(unsigned k = 0, n = order.size(); k < n; ++k){
+		unsigned g = order[k].second;
+		lits.insert(lits.end(), _fecLits.begin() + _fecBegin[g], _fecLits.begin() + _fecBegin[g + 1]);
+		begin.push_back(lits.size());
+	}
+	_fecLits.swap(lits);
+	_fecBegin.swap(begin);
+}
@@ -0,0 +1,108 @@
+/****************************************************************************
+  FileName     [ cirSimd.h ]
+  PackageName  [ cir ]
+  Synopsis     [ Define bit-parallel simulation kernels ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2008-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef CIR_SIMD_H
+#define CIR_SIMD_H
+
+#include <cstddef>
+#include "cirDef.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Every gate owns SIM_WORDS consecutive words of simulation value.
+// The kernels use the widest vector unit enabled at compile time
+// (SIMDFLAG in make.cir; SSE2 is always on for x86-64) that SIM_WORDS
+// fills, and fall back to plain word operations elsewhere.
+// "inv" masks are 0 or ~0 and are XOR-ed into the corresponding input.
+
+#define SIM_MASK(inv)   ((inv) ? ~size_t(0) : size_t(0))
+
+// out = (a ^ ma) & (b ^ mb)
+inline void
+simAnd(size_t *out, const size_t *a, size_t ma, const size_t *b, size_t mb)
+{
+#if defined(__AVX512F__) && SIM_WORDS >= 8
+   static_assert(SIM_WORDS % 8 == 0, "SIM_WORDS must fill whole 512-bit vectors");
+   const __m512i va = _mm512_set1_epi64(ma), vb = _mm512_set1_epi64(mb);
+   for (unsigned i = 0; i < SIM_WORDS; i += 8) {
+      __m512i x = _mm512_xor_si512(_mm512_loadu_si512((const void*)(a + i)), va);
+      __m512i y = _mm512_xor_si512(_mm512_loadu_si512((const void*)(b + i)), vb);
+      _mm512_storeu_si512((void*)(out + i), _mm512_and_si512(x, y));
+   }
+#elif defined(__AVX2__)
+   static_assert(SIM_WORDS % 4 == 0, "SIM_WORDS must fill whole 256-bit vectors");
+   const __m256i va = _mm256_set1_epi64x(ma), vb = _mm256_set1_epi64x(mb);
+   for (unsigned i = 0; i < SIM_WORDS; i += 4) {
+      __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(a + i)), va);
+      __m256i y = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(b + i)), vb);
+      _mm256_storeu_si256((__m256i*)(out + i), _mm256_and_si256(x, y));
+   }
+#elif defined(__SSE2__)
+   static_assert(SIM_WORDS % 2 == 0, "SIM_WORDS must fill whole 128-bit vectors");
+   const __m128i va = _mm_set1_epi64x(ma), vb = _mm_set1_epi64x(mb);
+   for (unsigned i = 0; i < SIM_WORDS; i += 2) {
+      __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i)), va);
+      __m128i y = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(b + i)), vb);
+      _mm_storeu_si128((__m128i*)(out + i), _mm_and_si128(x, y));
+   }
+#else
+   for (unsigned i = 0; i < SIM_WORDS; ++i)
+      out[i] = (a[i] ^ ma) & (b[i] ^ mb);
+#endif
+}
+
+// out = a ^ ma
+inline void
+simBuf(size_t *out, const size_t *a, size_t ma)
+{
+   for (unsigned i = 0; i < SIM_WORDS; ++i)
+      out[i] = a[i] ^ ma;
+}
+
+// return true if a ^ ma == b ^ mb in every word
+inline bool
+simEqual(const size_t *a, size_t ma, const size_t *b, size_t mb)
+{
+   const size_t m = ma ^ mb;
+   for (unsigned i = 0; i < SIM_WORDS; ++i)
+      if ((a[i] ^ b[i]) != m) return false;
+   return true;
+}
+
+// return true if every bit set in a ^ ma is set in b ^ mb
+inline bool
+simImplies(const size_t *a, size_t ma, const size_t *b, size_t mb)
+{
+   for (unsigned i = 0; i < SIM_WORDS; ++i)
+      if ((a[i] ^ ma) & ~(b[i] ^ mb)) return false;
+   return true;
+}
+
+// return true if a ^ ma == (b ^ mb) & (c ^ mc) in every word
+inline bool
+simEqualAnd(const size_t *a, size_t ma, const size_t *b, size_t mb,
+            const size_t *c, size_t mc)
+{
+   for (unsigned i = 0; i < SIM_WORDS; ++i)
+      if ((a[i] ^ ma) != ((b[i] ^ mb) & (c[i] ^ mc))) return false;
+   return true;
+}
+
+// hash of a ^ ma over all words
+inline size_t
+simHash(const size_t *a, size_t ma)
+{
+   size_t h = 0;
+   for (unsigned i = 0; i < SIM_WORDS; ++i)
+      h = (h ^ (a[i] ^ ma)) * size_t(0x100000001b3ULL) + i;
+   return h;
+}
+
+#endif // CIR_SIMD_H
@@ -745,26 +745,28 @@ void Solver::claRescaleActivity()
 
 /*_________________________________________________________________________________________________
 |
-|  solve : (assumps : const vec<Lit>&)  ->  [bool]
+|  solve : (assumps : const vec<Lit>&) (max_conflicts : int64)  ->  [lbool]
 |  
 |  Description:
 |    Top-level solve. If using assumptions (non-empty 'assumps' vector), you must call
 |    'simplifyDB()' first to see that no top-level conflict is present (which would put the solver
-|    in an undefined state).
+|    in an undefined state). Returns 'l_Undef' if 'max_conflicts' is not negative and that many
+|    conflicts pass before the problem is decided; there is no model then.
 |  
 |  Input:
 |    A list of assumptions (unit clauses coded as literals). Pre-condition: The assumptions must
 |    not contain both 'x' and '~x' for any variable 'x'.
 |________________________________________________________________________________________________@*/
-bool Solver::solve(const vec<Lit>& assumps)
+lbool Solver::solve(const vec<Lit>& assumps, int64 max_conflicts)
 {
     simplifyDB();
-    if (!ok) return false;
+    if (!ok) return l_False;
 
     SearchParams    params(default_params);
     double  nof_conflicts = 100;
     double  nof_learnts   = nClauses() / 3;
     lbool   status        = l_Undef;
+    int64   conflicts0    = stats.conflicts;
 
     // Perform assumptions:
     root_level = assumps.size();
@@ -782,12 +784,12 @@ bool Solver::solve(const vec<Lit>& assumps)
                 if (proof != NULL) conflict_id = unit_id[var(p)];
             }
             cancelUntil(0);
-            return false; }
+            return l_False; }
         Clause* confl = propagate();
         if (confl != NULL){
             analyzeFinal(confl), assert(conflict.size() > 0);
             cancelUntil(0);
-            return false; }
+            return l_False; }
     }
     assert(root_level == decisionLevel());
 
@@ -821,8 +823,11 @@ bool Solver::solve(const vec<Lit>& assumps)
 
 if ((int)stats.conflicts >= effLimit) {
    cancelUntil(0);
-   return status == l_True;
+   return status;
 }
+        if (status == l_Undef && max_conflicts >= 0 && stats.conflicts - conflicts0 >= max_conflicts){
+            cancelUntil(0);
+            return l_Undef; }
     }
     if (verbosity >= 1) {
         reportf("===========================================");
@@ -830,7 +835,7 @@ if ((int)stats.conflicts >= effLimit) {
     }
 
     cancelUntil(0);
-    return status == l_True;
+    return status;
 }
 
 void Solver::printStats()
@@ -190,7 +190,8 @@ public:
     //
     bool    okay() { return ok; }       // FALSE means solver is in an conflicting state (must never be used again!)
     void    simplifyDB();
-    bool    solve(const vec<Lit>& assumps);
+    lbool   solve(const vec<Lit>& assumps, int64 max_conflicts);   // 'l_Undef' if 'max_conflicts' (if >= 0) runs out first.
+    bool    solve(const vec<Lit>& assumps) { return solve(assumps, -1) == l_True; }
     bool    solve() { vec<Lit> tmp; return solve(tmp); }
 
     double      progress_estimate;  // Set by 'search()'.
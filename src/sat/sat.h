@@ -71,6 +71,8 @@ class SatSolver
          _assump.push(val? Lit(prop): ~Lit(prop));
       }
       bool assumpSolve() { return _solver->solve(_assump); }
+      // At most "nConf" conflicts; l_Undef (no model) if they run out
+      lbool assumpSolve(int nConf) { return _solver->solve(_assump, nConf); }
 
       // For one time proof, use "solve"
       void assertProperty(Var prop, bool val) {
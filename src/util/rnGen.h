@@ -12,6 +12,7 @@
 #include <sys/types.h>
 #include <stdlib.h>  
 #include <limits.h>
+#include <stdint.h>
 
 #define my_srandom  srandom
 #define my_random   random
@@ -26,5 +27,42 @@ class RandomNumGen
       }
 };
 
+// Full 64-bit random words by xoshiro256**; the state is expanded from
+// the seed with splitmix64 so that any seed (even 0) gives a good stream
+class RandomWordGen
+{
+   public:
+      RandomWordGen() { seed(getpid()); }
+      RandomWordGen(uint64_t s) { seed(s); }
+      void seed(uint64_t s) {
+         for (int i = 0; i < 4; ++i) _s[i] = splitMix(s);
+      }
+      uint64_t operator() () {
+         const uint64_t r = rotl(_s[1] * 5, 7) * 9;
+         const uint64_t t = _s[1] << 17;
+         _s[2] ^= _s[0]; _s[3] ^= _s[1];
+         _s[1] ^= _s[2]; _s[0] ^= _s[3];
+         _s[2] ^= t; _s[3] = rotl(_s[3], 45);
+         return r;
+      }
+      // fill n words, e.g. a multi-word simulation pattern
+      void fill(size_t *w, unsigned n) {
+         for (unsigned i = 0; i < n; ++i) w[i] = size_t((*this)());
+      }
+
+   private:
+      uint64_t _s[4];
+
+      static uint64_t rotl(uint64_t x, int k) {
+         return (x << k) | (x >> (64 - k));
+      }
+      static uint64_t splitMix(uint64_t& x) {
+         uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+         z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+         z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+         return z ^ (z >> 31);
+      }
+};
+
 #endif // RN_GEN_H
 
@@ -0,0 +1,35 @@
+# Build the miter of two ASCII AIGER files with the same PIs and POs:
+# PO i of the miter is the XOR of PO i of the two circuits, so the two
+# are equivalent when every PO of the miter is proven constant 0.
+# Usage -- awk -f miter.awk a.aag b.aag > miter.aag
+function newLit(f, l) { return 2 * id[f, int(l / 2)] + l % 2 }
+function newAnd(a, b) { ++m; ands[++na] = 2 * m " " a " " b; return 2 * m }
+FNR == 1 {
+   ++f; nIn = $3; nOut = $5; nAnd[f] = $6
+   next
+}
+FNR <= 1 + nIn { id[f, $1 / 2] = FNR - 1; next }
+FNR <= 1 + nIn + nOut { out[f, FNR - 1 - nIn] = $1; next }
+FNR <= 1 + nIn + nOut + nAnd[f] {
+   k = FNR - 1 - nIn - nOut
+   lhs[f, k] = $1; rhs0[f, k] = $2; rhs1[f, k] = $3
+}
+END {
+   m = nIn
+   for (f = 1; f <= 2; ++f)
+      for (k = 1; k <= nAnd[f]; ++k) id[f, lhs[f, k] / 2] = ++m
+   for (f = 1; f <= 2; ++f)
+      for (k = 1; k <= nAnd[f]; ++k)
+         ands[++na] = 2 * id[f, lhs[f, k] / 2] " " newLit(f, rhs0[f, k]) \
+                      " " newLit(f, rhs1[f, k])
+   for (i = 1; i <= nOut; ++i) {
+      a = newLit(1, out[1, i]); b = newLit(2, out[2, i])
+      t0 = newAnd(a, b + 1 - 2 * (b % 2))
+      t1 = newAnd(a + 1 - 2 * (a % 2), b)
+      po[i] = newAnd(t0 + 1, t1 + 1) + 1
+   }
+   print "aag", m, nIn, 0, nOut, na
+   for (i = 1; i <= nIn; ++i) print 2 * i
+   for (i = 1; i <= nOut; ++i) print po[i]
+   for (k = 1; k <= na; ++k) print ands[k]
+}